@@ -13,7 +13,7 @@ using namespace rv;
 void entitiesTest();
 void performanceTest();
 
-int main(int argc, char** argv)
+int main()
 {
 	entitiesTest();
 	// performanceTest();
@@ -75,27 +75,21 @@ void entitiesTest()
 
 void performanceTest()
 {
-	size_t entityCount = 10'000'000;
-	for (int32_t i = 0; i < entityCount; i++)
-	{
-		if (i < entityCount / 2)
-		{
-			EntityRegistry::createEntity<Velocity, Position>();
-		}
-		else
-		{
-			EntityRegistry::createEntity<Velocity, Position, Comflabulation>();
-		}
-
-		if (i % 1000 == 0)
-		{
-			float prog = (i / (double)entityCount) * 100.0;
-			fprintf(stdout, "Entities Allocation (%f%%)\n", prog);
-		}
-	}
-
-	ISystem* comflabuSystem = new ComflabulationSystem();
-	ISystem* movementSystem = new MovementSystem();
+	const int32_t entityCount = 10'000'000;
+	fprintf(stdout, "Entities Allocation (%i)\n", entityCount);
+	EntityRegistry::createEntities<Velocity, Position>(entityCount / 2);
+	EntityRegistry::createEntities<Velocity, Position, Comflabulation>(entityCount - entityCount / 2);
+
+	tf::Executor executor;
+	ComflabulationSystem* comflabuSystem = new ComflabulationSystem();
+	MovementSystem* movementSystem = new MovementSystem();
+	comflabuSystem->setParallel(&executor);
+	movementSystem->setParallel(&executor);
+
+	// Both systems have no components in common, so they run concurrently
+	SystemsManager systemsManager(executor);
+	systemsManager.addSystem(movementSystem);
+	systemsManager.addSystem(comflabuSystem);
 
 	const size_t testCount = 1'000;
 	double acc = 0;
@@ -104,8 +98,7 @@ void performanceTest()
 	{
 		auto start = std::chrono::system_clock::now();
 
-		movementSystem->update(0.016);
-		comflabuSystem->update(0.016);
+		systemsManager.update(0.016);
 
 		auto end = std::chrono::system_clock::now();
 		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
@@ -1,2 +1,3 @@
 #include "ecs/BaseSystem.hpp"
-#include "ecs/EntityRegistry.hpp"
\ No newline at end of file
+#include "ecs/EntityRegistry.hpp"
+#include "ecs/SystemsManager.hpp"
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef ALIGNEDMEMORY_H
+#define ALIGNEDMEMORY_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace rv
+{
+
+	/**
+	 * @brief Allocates a block of memory aligned to the given boundary.
+	 *
+	 * @param bytes Size of the block.
+	 * @param alignment Alignment of the block (power of two, multiple of sizeof(void*)).
+	 * @return Aligned block, or nullptr on failure. Must be freed through alignedFree.
+	 */
+	inline void* alignedMalloc(const size_t bytes, const size_t alignment)
+	{
+#if defined(_WIN32)
+		return _aligned_malloc(bytes, alignment);
+#else
+		void* ptr = nullptr;
+		return (posix_memalign(&ptr, alignment, bytes) == 0) ? ptr : nullptr;
+#endif
+	}
+
+	/**
+	 * @brief Frees a block allocated by alignedMalloc.
+	 */
+	inline void alignedFree(void* ptr)
+	{
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+} // namespace rv
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef ARCHETYPEREGISTRY_H
+#define ARCHETYPEREGISTRY_H
+
+#include "Assert.h"
+#include "ComponentType.h"
+#include "Entity.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace rv
+{
+	typedef int32_t QueryId;
+	static constexpr QueryId InvalidQuery = -1;
+
+	/**
+	 * @brief Interns component type lists into small integer ids.
+	 * Archetypes are the exact type lists of entities, queries are the type lists systems run through
+	 * (required types, and optionally types whose archetypes are excluded).
+	 * Type lists are sorted (by component type id) before being interned, so the same types in any order
+	 * share the same id, and ids are assigned in first use order.
+	 */
+	class ArchetypeRegistry
+	{
+		struct Archetype
+		{
+			/**
+			 * @brief Sorted component types of the archetype.
+			 */
+			std::vector<ComponentTypeId> types;
+			/**
+			 * @brief Archetypes reached by adding a component type (resolved on first use).
+			 */
+			std::map<ComponentTypeId, ArchetypeId> addEdges;
+			/**
+			 * @brief Archetypes reached by removing a component type (resolved on first use).
+			 */
+			std::map<ComponentTypeId, ArchetypeId> removeEdges;
+		};
+
+		/**
+		 * @brief Sorted required and excluded component types of a query.
+		 */
+		using QueryKey = std::pair<std::vector<ComponentTypeId>, std::vector<ComponentTypeId>>;
+
+		struct Query
+		{
+			/**
+			 * @brief Sorted component types of the query.
+			 */
+			std::vector<ComponentTypeId> types;
+			/**
+			 * @brief Sorted component types whose archetypes are not matched by the query.
+			 */
+			std::vector<ComponentTypeId> excluded;
+			/**
+			 * @brief Archetypes holding all query types (and none of the excluded ones), in increasing id order.
+			 */
+			std::vector<ArchetypeId> archetypes;
+		};
+
+		static std::vector<Archetype> archetypes;
+		static std::map<std::vector<ComponentTypeId>, ArchetypeId> archetypeIds;
+		static std::vector<Query> queries;
+		static std::map<QueryKey, QueryId> queryIds;
+
+	  public:
+		/**
+		 * @brief Returns the archetype id of a type list, interning it on first use.
+		 *
+		 * @param types Component types of the archetype (any order).
+		 * @param count Amount of component types.
+		 * @return ArchetypeId Dense archetype id.
+		 */
+		inline static ArchetypeId getArchetype(const ComponentTypeId* types, const int32_t count);
+
+		/**
+		 * @brief Returns the query id of a type list, interning it on first use.
+		 *
+		 * @param types Component types of the query (any order).
+		 * @param count Amount of component types.
+		 * @param excluded Component types whose archetypes are not matched (any order).
+		 * @param excludedCount Amount of excluded component types.
+		 * @return QueryId Dense query id.
+		 */
+		inline static QueryId getQuery(const ComponentTypeId* types, const int32_t count,
+					       const ComponentTypeId* excluded = nullptr, const int32_t excludedCount = 0);
+
+		/**
+		 * @brief Returns the archetype with all types of the given one plus another type.
+		 *
+		 * @param archetype Source archetype.
+		 * @param type Component type to be added (the source archetype is returned if it already has it).
+		 * @return ArchetypeId Destination archetype id.
+		 */
+		inline static ArchetypeId getArchetypeWith(const ArchetypeId archetype, const ComponentTypeId type);
+
+		/**
+		 * @brief Returns the archetype with all types of the given one but a single type.
+		 *
+		 * @param archetype Source archetype.
+		 * @param type Component type to be removed (the source archetype is returned if it lacks it).
+		 * @return ArchetypeId Destination archetype id.
+		 */
+		inline static ArchetypeId getArchetypeWithout(const ArchetypeId archetype, const ComponentTypeId type);
+
+		inline static const std::vector<ComponentTypeId>& getTypes(const ArchetypeId archetype);
+
+		/**
+		 * @brief Either or not an archetype has the given component type.
+		 */
+		inline static bool hasType(const ArchetypeId archetype, const ComponentTypeId type);
+
+		/**
+		 * @brief Returns all archetypes matched by a query (in increasing id order).
+		 */
+		inline static const std::vector<ArchetypeId>& getArchetypes(const QueryId query);
+
+		inline static int32_t getArchetypeCount();
+
+	  private:
+		inline static bool matches(const Archetype& archetype, const Query& query);
+	};
+
+	// Static Definitions
+	inline std::vector<ArchetypeRegistry::Archetype> ArchetypeRegistry::archetypes;
+	inline std::map<std::vector<ComponentTypeId>, ArchetypeId> ArchetypeRegistry::archetypeIds;
+	inline std::vector<ArchetypeRegistry::Query> ArchetypeRegistry::queries;
+	inline std::map<ArchetypeRegistry::QueryKey, QueryId> ArchetypeRegistry::queryIds;
+
+	inline ArchetypeId ArchetypeRegistry::getArchetype(const ComponentTypeId* types, const int32_t count)
+	{
+		std::vector<ComponentTypeId> key(types, types + count);
+		std::sort(key.begin(), key.end());
+
+		// Get existing archetype
+		std::map<std::vector<ComponentTypeId>, ArchetypeId>::iterator it = archetypeIds.lower_bound(key);
+		if (it != archetypeIds.end() && it->first == key)
+		{
+			return it->second;
+		}
+
+		// Intern new archetype and add it to every query it matches
+		const ArchetypeId archetype = static_cast<ArchetypeId>(archetypes.size());
+		archetypeIds.insert(it, {key, archetype});
+		archetypes.push_back({std::move(key), {}, {}});
+		for (Query& query : queries)
+		{
+			if (matches(archetypes.back(), query))
+			{
+				query.archetypes.push_back(archetype);
+			}
+		}
+		return archetype;
+	}
+
+	inline QueryId ArchetypeRegistry::getQuery(const ComponentTypeId* types, const int32_t count,
+						   const ComponentTypeId* excluded, const int32_t excludedCount)
+	{
+		QueryKey key(std::vector<ComponentTypeId>(types, types + count),
+			     std::vector<ComponentTypeId>(excluded, excluded + excludedCount));
+		std::sort(key.first.begin(), key.first.end());
+		std::sort(key.second.begin(), key.second.end());
+
+		// Get existing query
+		std::map<QueryKey, QueryId>::iterator it = queryIds.lower_bound(key);
+		if (it != queryIds.end() && it->first == key)
+		{
+			return it->second;
+		}
+
+		// Intern new query and match it against all known archetypes
+		const QueryId query = static_cast<QueryId>(queries.size());
+		queryIds.insert(it, {key, query});
+		queries.push_back({std::move(key.first), std::move(key.second), {}});
+		for (ArchetypeId archetype = 0; archetype < getArchetypeCount(); archetype++)
+		{
+			if (matches(archetypes[archetype], queries.back()))
+			{
+				queries.back().archetypes.push_back(archetype);
+			}
+		}
+		return query;
+	}
+
+	inline ArchetypeId ArchetypeRegistry::getArchetypeWith(const ArchetypeId archetype, const ComponentTypeId type)
+	{
+		_ASSERT(archetype >= 0 && archetype < getArchetypeCount());
+		std::map<ComponentTypeId, ArchetypeId>::iterator it = archetypes[archetype].addEdges.find(type);
+		if (it != archetypes[archetype].addEdges.end())
+		{
+			return it->second;
+		}
+		if (hasType(archetype, type))
+		{
+			return archetype;
+		}
+
+		// Interning might reallocate the archetypes list, so the edge is only stored after it
+		std::vector<ComponentTypeId> types = archetypes[archetype].types;
+		types.push_back(type);
+		const ArchetypeId dstArchetype = getArchetype(types.data(), types.size());
+		archetypes[archetype].addEdges[type] = dstArchetype;
+		archetypes[dstArchetype].removeEdges[type] = archetype;
+		return dstArchetype;
+	}
+
+	inline ArchetypeId ArchetypeRegistry::getArchetypeWithout(const ArchetypeId archetype, const ComponentTypeId type)
+	{
+		_ASSERT(archetype >= 0 && archetype < getArchetypeCount());
+		std::map<ComponentTypeId, ArchetypeId>::iterator it = archetypes[archetype].removeEdges.find(type);
+		if (it != archetypes[archetype].removeEdges.end())
+		{
+			return it->second;
+		}
+		if (!hasType(archetype, type))
+		{
+			return archetype;
+		}
+
+		// Interning might reallocate the archetypes list, so the edge is only stored after it
+		std::vector<ComponentTypeId> types = archetypes[archetype].types;
+		types.erase(std::lower_bound(types.begin(), types.end(), type));
+		const ArchetypeId dstArchetype = getArchetype(types.data(), types.size());
+		archetypes[archetype].removeEdges[type] = dstArchetype;
+		archetypes[dstArchetype].addEdges[type] = archetype;
+		return dstArchetype;
+	}
+
+	inline const std::vector<ComponentTypeId>& ArchetypeRegistry::getTypes(const ArchetypeId archetype)
+	{
+		_ASSERT(archetype >= 0 && archetype < getArchetypeCount());
+		return archetypes[archetype].types;
+	}
+
+	inline bool ArchetypeRegistry::hasType(const ArchetypeId archetype, const ComponentTypeId type)
+	{
+		const std::vector<ComponentTypeId>& types = getTypes(archetype);
+		return std::binary_search(types.begin(), types.end(), type);
+	}
+
+	inline const std::vector<ArchetypeId>& ArchetypeRegistry::getArchetypes(const QueryId query)
+	{
+		_ASSERT(query >= 0 && query < static_cast<QueryId>(queries.size()));
+		return queries[query].archetypes;
+	}
+
+	inline int32_t ArchetypeRegistry::getArchetypeCount() { return static_cast<int32_t>(archetypes.size()); }
+
+	inline bool ArchetypeRegistry::matches(const Archetype& archetype, const Query& query)
+	{
+		// All type lists are sorted
+		if (!std::includes(archetype.types.begin(), archetype.types.end(), query.types.begin(), query.types.end()))
+		{
+			return false;
+		}
+		for (const ComponentTypeId type : query.excluded)
+		{
+			if (std::binary_search(archetype.types.begin(), archetype.types.end(), type))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+} // namespace rv
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef ASSERT_H
+#define ASSERT_H
+
+// _ASSERT comes from the MSVC debug runtime, other compilers map it to the standard assert
+#if defined(_MSC_VER)
+#include <crtdbg.h>
+#elif !defined(_ASSERT)
+#include <assert.h>
+#define _ASSERT(expr) assert(expr)
+#endif
+
+#endif
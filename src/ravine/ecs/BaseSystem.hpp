@@ -1,10 +1,18 @@
 #ifndef BASESYSTEM_HPP
 #define BASESYSTEM_HPP
 
+#include "Assert.h"
+#include "ChangeTick.h"
+#include "ComponentTraits.h"
 #include "EntityRegistry.hpp"
 #include "ISystem.h"
 #include "TemplateIndexPack.h"
 
+#include <array>
+#include <functional>
+#include <memory>
+#include <taskflow/taskflow.hpp>
+
 using std::get;
 
 namespace rv
@@ -14,18 +22,121 @@ namespace rv
 	class BaseSystem : public ISystem
 	{
 	  private:
-		tuple<CompGroupIt<TComps>...> compGroupIts;
-		tuple<TComps*...> chunkData;
+		/**
+		 * @brief Contiguous range of a single group, processed as part of a work item.
+		 */
+		struct WorkRange
+		{
+			int32_t groupId;
+			int32_t begin;
+			int32_t end;
+			int32_t offset;
+		};
 
-		template <int... T>
-		struct FetchPack;
+		tuple<CompGroupIt<StoredComponent<TComps>>...> compGroupIts;
+
+		/**
+		 * @brief Query of this system, matching the archetypes with all required (non-optional and \see{with})
+		 * component types and none of the \see{without} ones.
+		 */
+		QueryId query = InvalidQuery;
+
+		/**
+		 * @brief Component types every matched archetype must have.
+		 */
+		std::vector<ComponentTypeId> requiredTypes;
+
+		/**
+		 * @brief Component types no matched archetype may have.
+		 */
+		std::vector<ComponentTypeId> excludedTypes;
+
+		/**
+		 * @brief Index of the first required component type, its groups give the sizes of all groups.
+		 */
+		static constexpr size_t PrimaryIndex = []() {
+			constexpr bool optional[] = {IsOptional<TComps>::value...};
+			size_t index = 0;
+			while (index < sizeof...(TComps) && optional[index])
+			{
+				index++;
+			}
+			return index;
+		}();
+		static_assert(PrimaryIndex < sizeof...(TComps), "A system needs at least one non-optional component type");
+
+		/**
+		 * @brief Query version the cached iterators were built with.
+		 */
+		uint64_t queryVersion = UINT64_MAX;
+
+		/**
+		 * @brief Amount of entities of all queried groups.
+		 */
+		int32_t batchSize = 0;
 
-		template <>
-		struct FetchPack<>
+		/**
+		 * @brief Executor of the parallel update mode (nullptr on the serial mode).
+		 */
+		tf::Executor* executor = nullptr;
+
+		/**
+		 * @brief Amount of entities per work item on the parallel update mode.
+		 */
+		int32_t grainSize = DefaultGrainSize;
+
+		/**
+		 * @brief Parallel update graph, built once and reused on every update.
+		 */
+		std::unique_ptr<tf::Taskflow> taskflow;
+
+		/**
+		 * @brief Ranges of all work items (contiguous per item).
+		 */
+		std::vector<WorkRange> workRanges;
+
+		/**
+		 * @brief First range of each work item (with an extra entry marking the end of the last one).
+		 */
+		std::vector<int32_t> workItems;
+
+		/**
+		 * @brief Amount of work items.
+		 */
+		int32_t workCount = 0;
+
+		/**
+		 * @brief Time step of the current update (read by the parallel work items).
+		 */
+		double updateDeltaTime = 0.0;
+
+		/**
+		 * @brief Either or not only groups changed since the last update are processed.
+		 */
+		bool changedOnly = false;
+
+		/**
+		 * @brief Tick taken by the last update, this system's own writes are stamped with it.
+		 */
+		uint64_t lastUpdateTick = 0;
+
+		/**
+		 * @brief Either or not each queried group is processed on the current update.
+		 */
+		std::vector<uint8_t> groupsToUpdate;
+
+		/**
+		 * @brief Either or not each queried group is a single contiguous span on all storages (same tips).
+		 */
+		std::vector<uint8_t> groupsContiguous;
+
+		// Empty pack (recursion end), explicit specializations are not allowed at class scope
+		template <int... T>
+		struct FetchPack
 		{
-			static inline intptr_t fetchChunk(tuple<TComps*...>& chunkData,
-							  tuple<CompGroupIt<TComps>...>& compIt, int32_t groupId,
-							  int32_t fetchId)
+			static inline int32_t fetchChunk([[maybe_unused]] tuple<QueriedComponent<TComps>*...>& chunkData,
+							 [[maybe_unused]] tuple<CompGroupIt<StoredComponent<TComps>>...>& compIt,
+							 [[maybe_unused]] int32_t groupId, [[maybe_unused]] int32_t fetchId)
 			{
 				return INT32_MAX;
 			}
@@ -34,74 +145,372 @@ namespace rv
 		template <int I, int... S>
 		struct FetchPack<I, S...>
 		{
-			static inline int32_t fetchChunk(tuple<TComps*...>& chunkData,
-							 tuple<CompGroupIt<TComps>...>& compIt, int32_t groupId,
+			static inline int32_t fetchChunk(tuple<QueriedComponent<TComps>*...>& chunkData,
+							 tuple<CompGroupIt<StoredComponent<TComps>>...>& compIt, int32_t groupId,
 							 int32_t fetchId)
 			{
 				int32_t lGroupSize = 0;
-				get<I>(chunkData) = get<I>(compIt).compIt[groupId].getChunk(fetchId, lGroupSize);
+				get<I>(chunkData) = get<I>(compIt)[groupId].getChunk(fetchId, lGroupSize);
 				int32_t rGroupSize = FetchPack<S...>::fetchChunk(chunkData, compIt, groupId, fetchId);
 				return (lGroupSize < rGroupSize) ? lGroupSize : rGroupSize;
 			}
 		};
 
 		/**
-		 * @brief Calls the virtual \see{update} function by unfolding their arguments with a compile-time
-		 * sequence list.
+		 * @brief Calls the virtual \see{update} function for every chunk of a group range, by unfolding
+		 * their arguments with a compile-time sequence list.
 		 *
 		 * @tparam S Type list id sequence
 		 * @param deltaTime Time since last update
-		 * @param componentIt Iterator for each component type this system runs through
+		 * @param range Group range to be processed
 		 */
 		template <int... S>
-		inline void updateUnfold(double deltaTime, seq<S...>)
+		inline void updateRange(double deltaTime, const WorkRange& range, seq<S...>)
 		{
-			beforeUpdate(deltaTime);
+			// Unrolled groups (\see{EntityRegistry::setLockstepTips}) are processed as a single chunk
+			if (groupsContiguous[range.groupId])
+			{
+				update(deltaTime, range.offset, batchSize, range.end - range.begin,
+				       get<S>(compGroupIts)[range.groupId].getSpan(range.begin)...);
+				return;
+			}
+
+			tuple<QueriedComponent<TComps>*...> chunkData;
+			int32_t fetchIt = range.begin;
+			int32_t offset = range.offset;
+			while (fetchIt < range.end)
+			{
+				int32_t chunkSize = FetchPack<S...>::fetchChunk(chunkData, compGroupIts, range.groupId, fetchIt);
+				chunkSize = (chunkSize < range.end - fetchIt) ? chunkSize : range.end - fetchIt;
+				update(deltaTime, offset, batchSize, chunkSize, get<S>(chunkData)...);
+				fetchIt += chunkSize;
+				offset += chunkSize;
+			}
+		}
 
-			const uint8_t groupCount = get<0>(compGroupIts).count;
+		/**
+		 * @brief Calls the virtual \see{update} function for every group, on the calling thread.
+		 *
+		 * @param deltaTime Time since last update
+		 */
+		inline void updateSerial(double deltaTime)
+		{
+			const int32_t groupCount = get<0>(compGroupIts).count;
 			int32_t offset = 0;
-			int32_t batchSize = 0;
-			for (uint8_t i = 0; i < groupCount; i++)
+			for (int32_t i = 0; i < groupCount; i++)
 			{
-				batchSize += get<0>(compGroupIts).compIt[i].getSize();
+				const int32_t groupSize = get<PrimaryIndex>(compGroupIts)[i].getSize();
+				if (groupsToUpdate[i])
+				{
+					updateRange(deltaTime, {i, 0, groupSize, offset}, typename gens<sizeof...(TComps)>::type());
+				}
+				offset += groupSize;
 			}
-			for (uint8_t i = 0; i < groupCount; i++)
+		}
+
+		/**
+		 * @brief Calls the virtual \see{update} function for every range of a work item.
+		 *
+		 * @param item Work item to be processed
+		 */
+		inline void updateWorkItem(const int32_t item)
+		{
+			for (int32_t r = workItems[item]; r < workItems[item + 1]; r++)
 			{
-				int32_t fetchIt = 0;
-				int32_t groupSize = get<0>(compGroupIts).compIt[i].getSize();
-				while (fetchIt < groupSize)
+				if (groupsToUpdate[workRanges[r].groupId])
 				{
-					int32_t chunkSize =
-					    FetchPack<S...>::fetchChunk(chunkData, compGroupIts, i, fetchIt);
-					update(deltaTime, offset, batchSize, chunkSize, get<S>(chunkData)...);
-					fetchIt += chunkSize;
-					offset += chunkSize;
+					updateRange(updateDeltaTime, workRanges[r], typename gens<sizeof...(TComps)>::type());
 				}
 			}
+		}
 
-			afterUpdate(deltaTime);
+		/**
+		 * @brief Calls the virtual \see{update} function for every work item, on the executor workers.
+		 *
+		 * @param deltaTime Time since last update
+		 */
+		inline void updateParallel(double deltaTime)
+		{
+			if (!taskflow)
+			{
+				// Work items are read by reference, so the graph is valid across updates
+				taskflow = std::make_unique<tf::Taskflow>();
+				taskflow->for_each_index(int32_t(0), std::ref(workCount), int32_t(1),
+							 [this](int32_t item) { updateWorkItem(item); });
+			}
+			updateDeltaTime = deltaTime;
+			executor->run(*taskflow).wait();
+		}
+
+		/**
+		 * @brief Rebuilds the cached iterators (and work items) if the storages layout changed.
+		 */
+		inline void refreshQuery()
+		{
+			const uint64_t version = EntityRegistry::getQueryVersion<StoredComponent<TComps>...>();
+			if (version == queryVersion)
+			{
+				return;
+			}
+			compGroupIts = EntityRegistry::getComponentIterators<StoredComponent<TComps>...>(query);
+			queryVersion = version;
+			batchSize = 0;
+			groupsContiguous.resize(get<0>(compGroupIts).count);
+			for (int32_t i = 0; i < get<0>(compGroupIts).count; i++)
+			{
+				batchSize += get<PrimaryIndex>(compGroupIts)[i].getSize();
+				groupsContiguous[i] = isGroupContiguous(i, typename gens<sizeof...(TComps)>::type());
+			}
+			if (executor != nullptr)
+			{
+				buildWorkItems();
+			}
+		}
+
+		/**
+		 * @brief Selects the groups to be processed on this update and stamps the written (non-const)
+		 * components of those groups with a new tick.
+		 */
+		inline void prepareGroups()
+		{
+			const uint64_t tick = ChangeTick::advance();
+			const int32_t groupCount = get<0>(compGroupIts).count;
+			groupsToUpdate.resize(groupCount);
+			for (int32_t i = 0; i < groupCount; i++)
+			{
+				// Groups are checked before being stamped, so this system's own writes never select them
+				const bool toUpdate = !changedOnly || isGroupChanged(i, typename gens<sizeof...(TComps)>::type());
+				groupsToUpdate[i] = toUpdate;
+				if (toUpdate)
+				{
+					markGroupWritten(i, tick, typename gens<sizeof...(TComps)>::type());
+				}
+			}
+			lastUpdateTick = tick;
+		}
+
+		/**
+		 * @brief Either or not any component of a group was written since the last update.
+		 */
+		template <int... S>
+		inline bool isGroupChanged(const int32_t groupId, seq<S...>)
+		{
+			return (false || ... ||
+				ChangeTick::isNewer(get<S>(compGroupIts)[groupId].getChangeVersion(), lastUpdateTick));
+		}
+
+		/**
+		 * @brief Either or not a group is a single contiguous span on every storage (no chunk splitting).
+		 */
+		template <int... S>
+		inline bool isGroupContiguous(const int32_t groupId, seq<S...>)
+		{
+			return (true && ... && get<S>(compGroupIts)[groupId].isContiguous());
+		}
+
+		/**
+		 * @brief Stamps the mutable components of a group with the given tick (const components are skipped).
+		 */
+		template <int... S>
+		inline void markGroupWritten(const int32_t groupId, const uint64_t tick, seq<S...>)
+		{
+			((IsReadOnly<TComps>::value ? (void)0 : get<S>(compGroupIts)[groupId].markChanged(tick)), ...);
+		}
+
+		/**
+		 * @brief Splits all groups into work items of (up to) the grain size,
+		 * small groups are coalesced into a single item and huge groups are split over many.
+		 */
+		inline void buildWorkItems()
+		{
+			workRanges.clear();
+			workItems.clear();
+			workItems.push_back(0);
+			const int32_t groupCount = get<0>(compGroupIts).count;
+			int32_t itemSize = 0;
+			int32_t offset = 0;
+			for (int32_t i = 0; i < groupCount; i++)
+			{
+				const int32_t groupSize = get<PrimaryIndex>(compGroupIts)[i].getSize();
+				for (int32_t begin = 0; begin < groupSize;)
+				{
+					const int32_t count = min(groupSize - begin, grainSize - itemSize);
+					workRanges.push_back({i, begin, begin + count, offset});
+					begin += count;
+					offset += count;
+					itemSize += count;
+					if (itemSize == grainSize)
+					{
+						workItems.push_back(workRanges.size());
+						itemSize = 0;
+					}
+				}
+			}
+			if (itemSize > 0)
+			{
+				workItems.push_back(workRanges.size());
+			}
+			workCount = workItems.size() - 1;
+		}
+
+		/**
+		 * @brief Interns the query of the current required and excluded types.
+		 */
+		inline void internQuery()
+		{
+			query = ArchetypeRegistry::getQuery(requiredTypes.data(), requiredTypes.size(), excludedTypes.data(),
+							    excludedTypes.size());
+			// Forces the iterators to be rebuilt on the next update
+			queryVersion = UINT64_MAX;
+		}
+
+	  protected:
+		/**
+		 * @brief Restricts this system to archetypes that also have the given component types
+		 * (without running through them). Meant to be called from the system constructor.
+		 *
+		 * @tparam TFilters Required component types (const-qualifiers are ignored).
+		 */
+		template <class... TFilters>
+		inline void with()
+		{
+			(requiredTypes.push_back(ComponentTypeRegistry::typeId<StoredComponent<TFilters>>()), ...);
+			internQuery();
+		}
+
+		/**
+		 * @brief Excludes the archetypes with any of the given component types from this system,
+		 * filtering is done once per archetype and never per entity. Meant to be called from the system constructor.
+		 *
+		 * @tparam TFilters Excluded component types (const-qualifiers are ignored).
+		 */
+		template <class... TFilters>
+		inline void without()
+		{
+			(excludedTypes.push_back(ComponentTypeRegistry::typeId<StoredComponent<TFilters>>()), ...);
+			internQuery();
 		}
 
 	  public:
 		/**
-		 * @brief Update base function, called by the ECS framework \see{SystemManager}.
+		 * @brief Either or not each component type of this system is read-only (in the template list order).
+		 */
+		static constexpr std::array<bool, sizeof...(TComps)> ReadOnly = {IsReadOnly<TComps>::value...};
+
+		/**
+		 * @brief Amount of component types this system writes.
+		 */
+		static constexpr size_t WriteCount = (size_t(0) + ... + size_t(!IsReadOnly<TComps>::value));
+
+		/**
+		 * @brief Default amount of entities per work item on the parallel update mode.
+		 */
+		static constexpr int32_t DefaultGrainSize = 16 * 1024;
+
+		BaseSystem()
+		{
+			// Intern the query up-front, so concurrent (scheduled) updates never register it
+			((IsOptional<TComps>::value
+			      ? (void)0
+			      : requiredTypes.push_back(ComponentTypeRegistry::typeId<StoredComponent<TComps>>())),
+			 ...);
+			internQuery();
+		}
+
+		/**
+		 * @brief Update base function, called by the ECS framework \see{SystemsManager}.
 		 *
 		 * @param deltaTime Timespan between last and current frame (in seconds).
 		 */
 		void update(double deltaTime) final
 		{
-			// Get Updated List of Iterators
-			compGroupIts = EntityRegistry::getComponentIterators<TComps...>();
-			updateUnfold(deltaTime, typename gens<sizeof...(TComps)>::type());
+			refreshQuery();
+			prepareGroups();
+
+			beforeUpdate(deltaTime);
+			if (executor != nullptr)
+			{
+				updateParallel(deltaTime);
+			}
+			else
+			{
+				updateSerial(deltaTime);
+			}
+			afterUpdate(deltaTime);
 		}
 
+		/**
+		 * @brief Update called from a \see{SystemsManager} task, on the parallel mode the work items
+		 * are spawned on the task subflow (running on the manager executor).
+		 *
+		 * @param deltaTime Timespan between last and current frame (in seconds).
+		 * @param subflow Subflow of the scheduler task running this system.
+		 */
+		void update(double deltaTime, tf::Subflow& subflow) final
+		{
+			refreshQuery();
+			prepareGroups();
+
+			beforeUpdate(deltaTime);
+			if (executor != nullptr)
+			{
+				updateDeltaTime = deltaTime;
+				subflow.for_each_index(int32_t(0), workCount, int32_t(1),
+						       [this](int32_t item) { updateWorkItem(item); });
+				subflow.join();
+			}
+			else
+			{
+				updateSerial(deltaTime);
+			}
+			afterUpdate(deltaTime);
+		}
+
+		/**
+		 * @brief Gets the component types read and written by this system (const-qualified types are only read).
+		 */
+		void getAccess(std::vector<ComponentTypeId>& reads, std::vector<ComponentTypeId>& writes) const final
+		{
+			reads.clear();
+			writes.clear();
+			((IsReadOnly<TComps>::value ? reads : writes)
+			     .push_back(ComponentTypeRegistry::typeId<StoredComponent<TComps>>()),
+			 ...);
+		}
+
+		/**
+		 * @brief Enables the parallel update mode, where chunks are split into work items
+		 * run by the executor workers (the chunk \see{update} functions must be thread-safe).
+		 * Passing a nullptr executor gets back to the serial update mode.
+		 *
+		 * @param executor Executor to run the work items on (must outlive the system).
+		 * @param grainSize Amount of entities per work item.
+		 */
+		inline void setParallel(tf::Executor* executor, const int32_t grainSize = DefaultGrainSize)
+		{
+			_ASSERT(grainSize > 0);
+			this->executor = executor;
+			this->grainSize = grainSize;
+			// Forces the work items to be rebuilt on the next update
+			queryVersion = UINT64_MAX;
+		}
+
+		/**
+		 * @brief Enables processing only the groups changed since the last update of this system
+		 * (written by other systems, or with components added or removed), so reactive systems
+		 * cost nothing on idle frames. Offsets still count the skipped groups.
+		 *
+		 * @param changedOnly Either or not unchanged groups are skipped.
+		 */
+		inline void setChangedOnly(const bool changedOnly) { this->changedOnly = changedOnly; }
+
 		/**
 		 * @brief Update virtual function to be overriten by a System implementation.
 		 *  Called by the \see{BaseSystem} class through \see{SystemManager} command.
 		 *
 		 * @param deltaTime Timespan between last and current frame (in seconds).
 		 */
-		inline virtual void beforeUpdate(double deltaTime){};
+		inline virtual void beforeUpdate([[maybe_unused]] double deltaTime){};
 
 		/**
 		 * @brief Update virtual function to be overriten by a System implementation.
@@ -109,18 +518,20 @@ namespace rv
 		 *
 		 * @param deltaTime Timespan between last and current frame (in seconds).
 		 */
-		inline virtual void afterUpdate(double deltaTime){};
+		inline virtual void afterUpdate([[maybe_unused]] double deltaTime){};
 
 		/**
 		 * @brief Update virtual function to be overriten by a System implementation.
 		 *  Called by the \see{BaseSystem} class through \see{SystemManager} command.
 		 *
 		 * @param deltaTime Timespan between last and current frame (in seconds).
+		 * @param offset Position of the first entity of the chunk among all queried entities.
+		 * @param size Amount of entities of all queried groups.
 		 * @param batchSize Amount of entities the components represent.
 		 * @param components List expansion for each component type this system runs through.
 		 */
-		inline virtual void update(double deltaTime, int32_t offset, int32_t size, int32_t batchSize,
-					   TComps* const... components)
+		inline virtual void update(double deltaTime, [[maybe_unused]] int32_t offset, [[maybe_unused]] int32_t size,
+					   int32_t batchSize, QueriedComponent<TComps>* const... components)
 		{
 			update(deltaTime, batchSize, components...);
 		};
@@ -130,10 +541,11 @@ namespace rv
 		 *  Called by the \see{BaseSystem} class through \see{SystemManager} command.
 		 *
 		 * @param deltaTime Timespan between last and current frame (in seconds).
-		 * @param size Amount of entities the components represent.
+		 * @param batchSize Amount of entities the components represent.
 		 * @param components List expansion for each component type this system runs through.
 		 */
-		inline virtual void update(double deltaTime, int32_t batchSize, TComps* const... components){};
+		inline virtual void update([[maybe_unused]] double deltaTime, [[maybe_unused]] int32_t batchSize,
+					   [[maybe_unused]] QueriedComponent<TComps>* const... components){};
 	};
 
 } // namespace rv
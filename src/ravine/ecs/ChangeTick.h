@@ -0,0 +1,53 @@
+#ifndef CHANGETICK_H
+#define CHANGETICK_H
+
+#include <atomic>
+#include <stdint.h>
+
+namespace rv
+{
+
+	/**
+	 * @brief Global change counter, component groups are stamped with it whenever they are written.
+	 * Each system update, each structural change (components added/removed) and each component accessed for
+	 * writing takes a new tick, so a group changed since a given tick has a newer version than it.
+	 * Ticks are 64-bit, so they never wrap around in practice (versions are compared directly).
+	 */
+	class ChangeTick
+	{
+		static std::atomic<uint64_t> tick;
+
+	  public:
+		/**
+		 * @brief Takes a new tick (newer than every tick taken before it).
+		 */
+		inline static uint64_t advance() { return tick.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+		inline static uint64_t current() { return tick.load(std::memory_order_relaxed); }
+
+		/**
+		 * @brief Either or not a version is newer than the given tick.
+		 */
+		inline static constexpr bool isNewer(const uint64_t version, const uint64_t since) { return version > since; }
+	};
+
+	/**
+	 * @brief Tick of the last write to a component group. Systems scheduled concurrently (and random component
+	 * access from their updates) might stamp and read it at the same time, so it is a relaxed atomic.
+	 */
+	class ChangeVersion
+	{
+		std::atomic<uint64_t> version{0};
+
+	  public:
+		inline uint64_t get() const { return version.load(std::memory_order_relaxed); }
+
+		inline void set(const uint64_t tick) { version.store(tick, std::memory_order_relaxed); }
+	};
+
+	// Static Definitions
+	inline std::atomic<uint64_t> ChangeTick::tick{0};
+
+} // namespace rv
+
+#endif
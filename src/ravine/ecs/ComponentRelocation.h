@@ -0,0 +1,153 @@
+#ifndef COMPONENTRELOCATION_H
+#define COMPONENTRELOCATION_H
+
+#include "ComponentTraits.h"
+
+#include <new>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace rv
+{
+
+	/**
+	 * @brief Copy constructs components on uninitialized slots.
+	 *
+	 * @param dst Uninitialized slots to construct the components at.
+	 * @param src Components to copy from.
+	 * @param count Amount of components to copy.
+	 */
+	template <typename TComp>
+	inline void copyComponents(TComp* dst, const TComp* src, const int32_t count)
+	{
+		if constexpr (std::is_trivially_copyable<TComp>::value)
+		{
+			memcpy(dst, src, count * sizeof(TComp));
+		}
+		else
+		{
+			for (int32_t i = 0; i < count; i++)
+			{
+				new (dst + i) TComp(src[i]);
+			}
+		}
+	}
+
+	/**
+	 * @brief Copy constructs the same component on uninitialized slots.
+	 *
+	 * @param dst Uninitialized slots to construct the components at.
+	 * @param value Component to copy from.
+	 * @param count Amount of components to construct.
+	 */
+	template <typename TComp>
+	inline void fillComponents(TComp* dst, const TComp& value, const int32_t count)
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			new (dst + i) TComp(value);
+		}
+	}
+
+	/**
+	 * @brief Move constructs components on uninitialized slots, the sources are left moved-from.
+	 *
+	 * @param dst Uninitialized slots to construct the components at.
+	 * @param src Components to move from.
+	 * @param count Amount of components to move.
+	 */
+	template <typename TComp>
+	inline void moveConstructComponents(TComp* dst, TComp* src, const int32_t count)
+	{
+		if constexpr (std::is_trivially_copyable<TComp>::value)
+		{
+			memcpy(dst, src, count * sizeof(TComp));
+		}
+		else
+		{
+			for (int32_t i = 0; i < count; i++)
+			{
+				new (dst + i) TComp(std::move(src[i]));
+			}
+		}
+	}
+
+	/**
+	 * @brief Relocates components to uninitialized slots (ranges must not overlap).
+	 * The source slots are left uninitialized.
+	 *
+	 * @param dst Uninitialized slots to relocate the components to.
+	 * @param src Components to be relocated.
+	 * @param count Amount of components to relocate.
+	 */
+	template <typename TComp>
+	inline void relocateComponents(TComp* dst, TComp* src, const int32_t count)
+	{
+		if constexpr (IsTriviallyRelocatable<TComp>::value)
+		{
+			memcpy(dst, src, count * sizeof(TComp));
+		}
+		else
+		{
+			for (int32_t i = 0; i < count; i++)
+			{
+				new (dst + i) TComp(std::move(src[i]));
+				src[i].~TComp();
+			}
+		}
+	}
+
+	/**
+	 * @brief Relocates components to uninitialized slots, ranges might overlap.
+	 * The source slots that are not overwritten are left uninitialized.
+	 *
+	 * @param dst Uninitialized slots to relocate the components to.
+	 * @param src Components to be relocated.
+	 * @param count Amount of components to relocate.
+	 */
+	template <typename TComp>
+	inline void moveComponents(TComp* dst, TComp* src, const int32_t count)
+	{
+		if constexpr (IsTriviallyRelocatable<TComp>::value)
+		{
+			memmove(dst, src, count * sizeof(TComp));
+		}
+		else if (dst < src)
+		{
+			// Front to back, so every destination slot has already been vacated
+			relocateComponents(dst, src, count);
+		}
+		else if (dst > src)
+		{
+			// Back to front, so every destination slot has already been vacated
+			for (int32_t i = count - 1; i >= 0; i--)
+			{
+				new (dst + i) TComp(std::move(src[i]));
+				src[i].~TComp();
+			}
+		}
+	}
+
+	/**
+	 * @brief Destroys components, leaving their slots uninitialized.
+	 *
+	 * @param data Components to be destroyed.
+	 * @param count Amount of components to destroy.
+	 */
+	template <typename TComp>
+	inline void destroyComponents(TComp* data, const int32_t count)
+	{
+		if constexpr (!std::is_trivially_destructible<TComp>::value)
+		{
+			for (int32_t i = 0; i < count; i++)
+			{
+				data[i].~TComp();
+			}
+		}
+	}
+
+} // namespace rv
+
+#endif
@@ -1,305 +1,1037 @@
 #ifndef COMPONENTSTORAGE_HPP
 #define COMPONENTSTORAGE_HPP
 
-#include <map>
-#include <set>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 
+#include "AlignedMemory.h"
+#include "ArchetypeRegistry.h"
+#include "Assert.h"
+#include "ComponentTraits.h"
 #include "ComponentsGroup.hpp"
 #include "ComponentsIterator.hpp"
+#include "EntityGroup.hpp"
 #include "IComponentStorage.h"
+#include "VirtualMemory.h"
 
 namespace rv
 {
 	// Empty Namespace to avoid leaking using directives
 	namespace
 	{
-		// Registry def
-		using GroupMaskSet = std::set<GroupMask, GroupMaskCmp>;
-		using GroupsRegistry = std::map<intptr_t, GroupMaskSet>;
-		using GroupRegPair = GroupsRegistry::value_type;
-		using GroupsRegIt = GroupsRegistry::iterator;
 		// Groups Storage def
 		template <typename TComp>
 		using CompGroup = ComponentsGroup<TComp>;
 		template <typename TComp>
-		using GroupsMap = std::map<GroupMask, CompGroup<TComp>*, GroupMaskCmp>;
+		using GroupsList = std::vector<CompGroup<TComp>*>;
 		template <typename TComp>
-		using GroupMaskPair = typename GroupsMap<TComp>::value_type;
+		using GroupIt = typename GroupsList<TComp>::iterator;
 		template <typename TComp>
-		using GroupIt = typename GroupsMap<TComp>::iterator;
-		template <typename TComp>
-		using GroupCIt = typename GroupsMap<TComp>::const_iterator;
+		using GroupCIt = typename GroupsList<TComp>::const_iterator;
+
+		/**
+		 * @brief Policy for the reserved headroom (slack) left after each group of a storage.
+		 * Insertions fill the group slack first, so neighbouring groups are only rolled when it runs out.
+		 * Removals keep the freed slots as slack while the policy is enabled.
+		 */
+		struct SlackPolicy
+		{
+			/**
+			 * @brief Fixed amount of free slots reserved after a group.
+			 */
+			int32_t fixed = 0;
+			/**
+			 * @brief Amount of free slots reserved after a group, proportional to the group size.
+			 */
+			float ratio = 0.0f;
+
+			constexpr bool isEnabled() const { return fixed > 0 || ratio > 0.0f; }
+
+			constexpr int32_t getSlack(const int32_t groupSize) const
+			{
+				return fixed + static_cast<int32_t>(groupSize * ratio);
+			}
+		};
+
+		/**
+		 * @brief Policy for the capacity growth of a storage, whenever an insertion doesn't fit.
+		 * The new capacity is the largest of the current and the required capacities, times the growth factor,
+		 * so a factor of one grows to the exact requirement of each insertion (batches included).
+		 */
+		struct GrowthPolicy
+		{
+			/**
+			 * @brief Geometric growth factor (at least one).
+			 */
+			float factor = 1.2f;
+
+			constexpr int32_t getCapacity(const int32_t capacity, const int32_t required) const
+			{
+				return static_cast<int32_t>(max(capacity, required) * factor);
+			}
+		};
+
+		/**
+		 * @brief Policy for releasing the capacity of a storage once its population drops.
+		 * The storage is shrunk when its size drops below *threshold* of its capacity, keeping *headroom*
+		 * (relative to the used slots) for later insertions. Keeping *threshold* * (1 + *headroom*) well below
+		 * one avoids shrinking again right after, and the growth factor avoids growing right after.
+		 */
+		struct ShrinkPolicy
+		{
+			/**
+			 * @brief Ratio of the capacity the storage size must drop below to be shrunk (0 disables it).
+			 */
+			float threshold = 0.0f;
+			/**
+			 * @brief Amount of free slots kept after shrinking, proportional to the used slots.
+			 */
+			float headroom = 0.5f;
+
+			constexpr bool isEnabled() const { return threshold > 0.0f; }
+		};
 
 		template <typename TComp>
 		class ComponentStorage : public IComponentStorage
 		{
 
 		  private:
+			/**
+			 * @brief Alignment (in bytes) of the data block, never below the group alignment.
+			 */
+			static constexpr size_t dataAlignment =
+			    std::max({ComponentAlignment<TComp>::value, GroupAlignment<TComp>::value, alignof(TComp),
+				      sizeof(void*)});
+
+			/**
+			 * @brief Alignment of the group base offsets (in elements), the smallest amount of components
+			 * whose size is a multiple of the group alignment (in bytes).
+			 */
+			static constexpr int32_t groupAlignment = static_cast<int32_t>(
+			    GroupAlignment<TComp>::value / std::gcd(GroupAlignment<TComp>::value, sizeof(TComp)));
+
+			/**
+			 * @brief Capacity of a new storage, storages are never shrunk below it.
+			 */
+			static constexpr int32_t initialCapacity = 10;
+
+			static_assert((ComponentAlignment<TComp>::value & (ComponentAlignment<TComp>::value - 1)) == 0,
+				      "Component alignment must be a power of two");
+			static_assert((GroupAlignment<TComp>::value & (GroupAlignment<TComp>::value - 1)) == 0,
+				      "Group alignment must be a power of two");
+
 			int32_t size = 0;
 			int32_t capacity = 0;
 
+			/**
+			 * @brief Amount of bytes commited on the reserved address range (paged storages only).
+			 */
+			size_t committed = 0;
+
+			/**
+			 * @brief Headroom policy for the groups of this storage.
+			 */
+			SlackPolicy slackPolicy;
+
+			/**
+			 * @brief Capacity release policy of this storage.
+			 */
+			ShrinkPolicy shrinkPolicy;
+
+			/**
+			 * @brief Capacity growth policy of this storage.
+			 */
+			GrowthPolicy growthPolicy;
+
+			/**
+			 * @brief Buffer for the roll amounts of groups that need to make room for an insertion.
+			 */
+			std::vector<int32_t> rollBuffer;
+
+			/**
+			 * @brief Buffer for the components being moved between archetype groups.
+			 */
+			std::vector<TComp> moveBuffer;
+
+			/**
+			 * @brief Buffer for the new layout order of the groups being reordered.
+			 */
+			std::vector<int32_t> reorderBuffer;
+
+			/**
+			 * @brief Buffer for the new base offsets of the groups being reordered.
+			 */
+			std::vector<int32_t> offsetBuffer;
+
+			/**
+			 * @brief Layout position of the next group to be compacted (\see{compact}).
+			 */
+			int32_t compactCursor = 0;
+
 		  public:
 			TComp* data;
 
 			/**
-			 * @brief Organized storage of groups based on their representative mask values.
+			 * @brief Groups in layout order (as they are placed in memory), new groups are appended
+			 * and groups with a high churn are moved toward the end (\see{reorderGroups}).
+			 */
+			GroupsList<TComp> groups;
+			/**
+			 * @brief Archetype id of each group (in layout order).
+			 */
+			std::vector<ArchetypeId> groupsArchetype;
+			/**
+			 * @brief Amount of components inserted/removed on each group (in layout order), halved on every
+			 * reordering so it follows the recent workload.
 			 */
-			GroupsMap<TComp> groups;
+			std::vector<uint32_t> groupsChurn;
 			/**
-			 * @brief Organized storage of groups registry masks for each mask combination.
+			 * @brief Position of each archetype group in the layout (indexed by archetype id, -1 if absent).
 			 */
-			GroupsRegistry groupsRegistry;
+			std::vector<int32_t> groupsIndex;
 
-			ComponentStorage() : capacity(10), data((TComp*)malloc(10 * sizeof(TComp))) {}
+			ComponentStorage();
 
-			~ComponentStorage()
-			{
-				free(data);
-				groups.clear();
-				capacity = 0;
-			}
+			~ComponentStorage();
 
+			/**
+			 * @brief Grows the storage to (at least) the given capacity, as set by the growth policy.
+			 */
 			inline void grow(int32_t newCapacity = 0);
 
-			inline CompGroupIt<TComp> getComponentIterator(const intptr_t mask);
+			/**
+			 * @brief Grows the storage to (at least) the exact given capacity, in a single reallocation.
+			 */
+			inline void reserve(const int32_t newCapacity);
+
+			/**
+			 * @brief Reserves room for the given amount of components on an archetype group (creating it if
+			 * needed), so inserting them doesn't grow the storage nor roll its groups.
+			 *
+			 * @param archetype Archetype of the group.
+			 * @param count Amount of components to make room for.
+			 */
+			inline void reserve(const ArchetypeId archetype, const int32_t count);
+
+			inline void setGrowthPolicy(const GrowthPolicy& policy);
+
+			inline void setSlackPolicy(const SlackPolicy& policy);
+
+			inline void setShrinkPolicy(const ShrinkPolicy& policy);
+
+			/**
+			 * @brief Packs the groups and reduces the capacity to the used slots plus the given headroom.
+			 *
+			 * @param headroom Amount of free slots kept, proportional to the used slots.
+			 */
+			inline void shrink(const float headroom);
+
+			void applyShrinkPolicy() final;
+
+			/**
+			 * @brief Amount of live components on this storage.
+			 */
+			inline int32_t getSize() const { return size; }
+
+			/**
+			 * @brief Amount of component slots allocated (or commited) by this storage.
+			 */
+			inline int32_t getCapacity() const { return capacity; }
+
+			inline int32_t getGroupGap(GroupIt<TComp> groupIt);
+
+			/**
+			 * @brief Makes room for the given amount of components after a group, rolling the next groups and
+			 * growing the storage if needed.
+			 *
+			 * @param groupIt Group to make room on.
+			 * @param count Amount of components to make room for.
+			 * @param exact Either or not the storage grows to the exact requirement (ignoring the growth policy).
+			 */
+			inline void makeRoom(GroupIt<TComp> groupIt, const int32_t count, const bool exact = false);
+
+			inline void closeGaps(GroupIt<TComp> groupIt);
+
+			inline static constexpr int32_t alignGroupOffset(const int32_t offset);
+
+			inline CompGroupIt<TComp> getComponentIterator(const QueryId query);
+
+			inline CompGroup<TComp>* addComponent(const ArchetypeId archetype, const TComp* comps, int32_t count);
 
-			// TODO: Process many groups, each with different masks
-			inline CompGroup<TComp>* addComponent(const intptr_t* masks, const int32_t maskCount,
-							      const TComp* comps, int32_t count);
+			/**
+			 * @brief Adds components to an archetype group, moving them instead of copying.
+			 *
+			 * @param archetype Archetype of the group.
+			 * @param comps Components to move from (left moved-from).
+			 * @param count Amount of components.
+			 */
+			inline CompGroup<TComp>* addMovedComponents(const ArchetypeId archetype, TComp* comps, int32_t count);
+
+			/**
+			 * @brief Adds copies of a single component to an archetype group.
+			 *
+			 * @param archetype Archetype of the group.
+			 * @param value Component to copy from.
+			 * @param count Amount of components.
+			 */
+			inline CompGroup<TComp>* fillComponent(const ArchetypeId archetype, const TComp& value, int32_t count);
 
-			inline TComp* addComponent(const intptr_t* masks, const int32_t maskCount, const TComp& comp);
+			/**
+			 * @brief Makes room for new components on an archetype group and places them (\see{placer} is called
+			 * with the group, once it has room for them).
+			 */
+			template <class TPlacer>
+			inline CompGroup<TComp>* insertComponents(const ArchetypeId archetype, int32_t count, TPlacer&& placer);
+
+			inline TComp* addComponent(const ArchetypeId archetype, const TComp& comp);
+
+			inline GroupIt<TComp> findGroup(const ArchetypeId archetype);
+
+			/**
+			 * @brief Returns the component at a group position of an archetype group (nullptr if there is no such group).
+			 *
+			 * @param archetype Archetype of the group.
+			 * @param groupPos Position of the component inside the group.
+			 * @param markChanged Either or not the group is stamped as changed (the component will be written).
+			 * @return TComp* Pointer for the component address.
+			 */
+			inline TComp* getComponent(const ArchetypeId archetype, const int32_t groupPos, const bool markChanged);
 
-			inline GroupIt<TComp> getComponentGroup(const intptr_t* masks, const int32_t maskCount);
+			inline GroupIt<TComp> getComponentGroup(const ArchetypeId archetype);
 
-			inline GroupsRegIt getRegistryEntryIt(const intptr_t mask);
+			inline void flushEntityLookups(void (*callback)(const LookupList&));
 
 			inline static ComponentStorage<TComp>* getInstance();
 
-			void swapComponent(int32_t entityId, GroupMask oldTypeMask, GroupMask newTypeMask) final
+			void swapComponent(int32_t entityId, ArchetypeId oldArchetype, ArchetypeId newArchetype) final
 			{
-				// TODO: Implement Swapping
+				moveComponents(&entityId, 1, oldArchetype, newArchetype);
 			}
 
-			void removeComponent(int32_t entityId, GroupMask typeMask) final;
+			void moveComponents(const int32_t* groupPos, int32_t count, ArchetypeId srcArchetype,
+					    ArchetypeId dstArchetype) final;
+
+			inline void removeFromGroup(GroupIt<TComp> groupIt, const int32_t* groupPos, const int32_t count);
+
+			void removeComponent(int32_t entityId, ArchetypeId archetype) final;
+
+			void removeComponents(const int32_t* groupPos, int32_t count, ArchetypeId archetype) final;
+
+			void removeComponents(const GroupIdList& groupIdList) final;
+
+			void reorderGroups() final;
 
-			void removeComponents(GroupIdList groupIdList) final;
+			void unrollGroups() final;
+
+			bool compact(size_t& budget) final;
+
+			void shrinkToFit() final;
 		};
 
+		template <class TComp>
+		ComponentStorage<TComp>::ComponentStorage()
+		{
+			if constexpr (UsePagedStorage<TComp>::value)
+			{
+				// Reserve the whole address range up-front, pages are commited on demand
+				data = (TComp*)reserveMemory(alignToPage(PagedStorageReserve<TComp>::value));
+				if (data == nullptr)
+				{
+					fprintf(stderr, "ComponentStorage: failed to reserve %zu bytes of address space\n",
+						alignToPage(PagedStorageReserve<TComp>::value));
+					abort();
+				}
+				reserve(initialCapacity);
+			}
+			else
+			{
+				capacity = initialCapacity;
+				data = (TComp*)alignedMalloc(initialCapacity * sizeof(TComp), dataAlignment);
+			}
+		}
+
+		template <class TComp>
+		ComponentStorage<TComp>::~ComponentStorage()
+		{
+			// Destroy all live components (and their groups)
+			for (GroupIt<TComp> it = groups.begin(); it != groups.end(); it++)
+			{
+				destroyComponents((*it)->dataPos(), (*it)->size);
+				delete *it;
+			}
+
+			if constexpr (UsePagedStorage<TComp>::value)
+			{
+				releaseMemory(data, alignToPage(PagedStorageReserve<TComp>::value));
+			}
+			else
+			{
+				alignedFree(data);
+			}
+			groups.clear();
+			groupsArchetype.clear();
+			groupsChurn.clear();
+			groupsIndex.clear();
+			capacity = 0;
+			committed = 0;
+		}
+
 		template <class TComp>
 		inline void ComponentStorage<TComp>::grow(int32_t newCapacity)
 		{
-			const int32_t grow = max(capacity, newCapacity) * 1.2f;
-			TComp* newData = (TComp*)malloc(grow * sizeof(TComp));
-			memcpy(newData, data, capacity * sizeof(TComp));
-			free(data);
-			data = newData;
-			capacity = grow;
+			// The storage grows by at least one slot, whatever the policy
+			reserve(max(growthPolicy.getCapacity(capacity, newCapacity), capacity + 1));
 		}
 
 		template <class TComp>
-		inline CompGroupIt<TComp> ComponentStorage<TComp>::getComponentIterator(const intptr_t mask)
+		inline void ComponentStorage<TComp>::reserve(const int32_t newCapacity)
 		{
-			// Check if registry entry exists
-			GroupsRegIt regIt = groupsRegistry.find(mask);
-			if (regIt == groupsRegistry.end())
+			if (newCapacity <= capacity)
 			{
-				return CompGroupIt<TComp>();
+				return;
 			}
 
-			// Create Iterator
-			const int32_t groupCount = regIt->second.size();
-			CompGroup<TComp>** groupsWithMask = new CompGroup<TComp>*[groupCount];
-			int32_t i = 0;
-			for (const GroupMask& mask : regIt->second)
+			if constexpr (UsePagedStorage<TComp>::value)
+			{
+				// Commit only the missing pages, the data is never copied and its address is kept
+				// (so running out of the reserved range or of memory can't be recovered from)
+				const size_t bytes = alignToPage(newCapacity * sizeof(TComp));
+				if (bytes > alignToPage(PagedStorageReserve<TComp>::value))
+				{
+					fprintf(stderr, "ComponentStorage: out of paged storage reserve (%zu bytes max)\n",
+						alignToPage(PagedStorageReserve<TComp>::value));
+					abort();
+				}
+				if (!commitMemory(reinterpret_cast<uint8_t*>(data) + committed, bytes - committed))
+				{
+					fprintf(stderr, "ComponentStorage: failed to commit %zu bytes\n", bytes - committed);
+					abort();
+				}
+				committed = bytes;
+				capacity = static_cast<int32_t>(bytes / sizeof(TComp));
+			}
+			else
 			{
-				// Perform Groups Lookup
-				groupsWithMask[i] = groups[mask];
-				++i;
+				TComp* newData = (TComp*)alignedMalloc(newCapacity * sizeof(TComp), dataAlignment);
+				_ASSERT(newData != nullptr);
+				if constexpr (IsTriviallyRelocatable<TComp>::value)
+				{
+					memcpy(newData, data, capacity * sizeof(TComp));
+				}
+				else
+				{
+					// Only live components (inside groups) are relocated
+					for (GroupIt<TComp> it = groups.begin(); it != groups.end(); it++)
+					{
+						const CompGroup<TComp>* group = *it;
+						relocateComponents(newData + group->baseOffset, data + group->baseOffset,
+								   group->size);
+					}
+				}
+				alignedFree(data);
+				data = newData;
+				capacity = newCapacity;
 			}
-			CompGroupIt<TComp> it(groupsWithMask, groupCount, data);
+			version++;
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::reserve(const ArchetypeId archetype, const int32_t count)
+		{
+			makeRoom(getComponentGroup(archetype), count, true);
+		}
 
-			// Safe to perform cleanup now
-			delete[] groupsWithMask;
+		template <class TComp>
+		inline void ComponentStorage<TComp>::setGrowthPolicy(const GrowthPolicy& policy)
+		{
+			_ASSERT(policy.factor >= 1.0f);
+			growthPolicy = policy;
+		}
 
-			return it;
+		template <class TComp>
+		inline void ComponentStorage<TComp>::setSlackPolicy(const SlackPolicy& policy)
+		{
+			slackPolicy = policy;
 		}
 
-		// TODO: Process many groups, each with different masks
 		template <class TComp>
-		inline ComponentsGroup<TComp>* ComponentStorage<TComp>::addComponent(const intptr_t* masks,
-										     const int32_t maskCount,
-										     const TComp* comps, int32_t count)
+		inline void ComponentStorage<TComp>::setShrinkPolicy(const ShrinkPolicy& policy)
+		{
+			shrinkPolicy = policy;
+			applyShrinkPolicy();
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::shrink(const float headroom)
+		{
+			// Pack the groups first, so all the free slots are left after the last group
+			size_t budget = SIZE_MAX;
+			compactCursor = 0;
+			compact(budget);
+
+			int32_t end = 0;
+			if (!groups.empty())
+			{
+				const CompGroup<TComp>* lastGroup = groups.back();
+				end = lastGroup->baseOffset + lastGroup->size;
+				if (slackPolicy.isEnabled())
+				{
+					end += slackPolicy.getSlack(lastGroup->size);
+				}
+			}
+			const int32_t newCapacity = max(end + static_cast<int32_t>(end * headroom), initialCapacity);
+			if (newCapacity >= capacity)
+			{
+				return;
+			}
+
+			if constexpr (UsePagedStorage<TComp>::value)
+			{
+				// Decommit the pages after the new capacity, the data is never copied and its address is kept
+				const size_t bytes = alignToPage(newCapacity * sizeof(TComp));
+				if (bytes >= committed)
+				{
+					return;
+				}
+				decommitMemory(reinterpret_cast<uint8_t*>(data) + bytes, committed - bytes);
+				committed = bytes;
+				capacity = static_cast<int32_t>(bytes / sizeof(TComp));
+			}
+			else
+			{
+				// Only live components (inside groups) are relocated
+				TComp* newData = (TComp*)alignedMalloc(newCapacity * sizeof(TComp), dataAlignment);
+				for (GroupIt<TComp> it = groups.begin(); it != groups.end(); it++)
+				{
+					const CompGroup<TComp>* group = *it;
+					relocateComponents(newData + group->baseOffset, data + group->baseOffset, group->size);
+				}
+				alignedFree(data);
+				data = newData;
+				capacity = newCapacity;
+			}
+			version++;
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::applyShrinkPolicy()
+		{
+			if (shrinkPolicy.isEnabled() && size < capacity * shrinkPolicy.threshold)
+			{
+				shrink(shrinkPolicy.headroom);
+			}
+		}
+
+		template <class TComp>
+		inline int32_t ComponentStorage<TComp>::getGroupGap(GroupIt<TComp> groupIt)
+		{
+			// Free slots between the group end and the next group base (or the storage end)
+			const CompGroup<TComp>* group = *groupIt;
+			GroupIt<TComp> nextIt = std::next(groupIt);
+			const int32_t nextBase = (nextIt == groups.end()) ? capacity : (*nextIt)->baseOffset;
+			return nextBase - (group->baseOffset + group->size);
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::makeRoom(GroupIt<TComp> groupIt, const int32_t count, const bool exact)
+		{
+			// Check if the group slack already fits the new components
+			if (count <= getGroupGap(groupIt))
+			{
+				return;
+			}
+
+			// Required group end, reserving headroom for the next insertions on this group
+			const CompGroup<TComp>* group = *groupIt;
+			int32_t reqEnd = group->baseOffset + group->size + count + slackPolicy.getSlack(group->size + count);
+
+			// Compute the roll of each effected group, their own slack absorbs part of it
+			// and their base offsets are kept aligned
+			rollBuffer.clear();
+			GroupIt<TComp> it = groupIt;
+			for (it++; it != groups.end() && (*it)->baseOffset < reqEnd; it++)
+			{
+				const int32_t newBase = alignGroupOffset(reqEnd);
+				rollBuffer.push_back(newBase - (*it)->baseOffset);
+				reqEnd = newBase + (*it)->size;
+			}
+
+			// Check if we have enough space (batches might need more than a single growth step)
+			if (reqEnd > capacity)
+			{
+				if (exact)
+				{
+					reserve(reqEnd);
+				}
+				else
+				{
+					grow(reqEnd);
+				}
+			}
+
+			// Make space for the new components (from right to left)
+			for (int32_t i = rollBuffer.size() - 1; i >= 0; i--)
+			{
+				it--;
+				(*it)->rollClockwise(rollBuffer[i]);
+			}
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::closeGaps(GroupIt<TComp> groupIt)
 		{
-			// Check if we have enough space
-			if (size + count >= capacity)
+			// Roll every group after the given one back, right after the end of its predecessor
+			int32_t end = (*groupIt)->baseOffset + (*groupIt)->size;
+			for (groupIt++; groupIt != groups.end(); groupIt++)
 			{
-				grow();
+				CompGroup<TComp>* group = *groupIt;
+				group->rollCounterClockwise(group->baseOffset - alignGroupOffset(end));
+				end = group->baseOffset + group->size;
 			}
+		}
 
-			GroupIt<TComp> groupIt = getComponentGroup(masks, maskCount);
+		template <class TComp>
+		inline constexpr int32_t ComponentStorage<TComp>::alignGroupOffset(const int32_t offset)
+		{
+			return (offset + groupAlignment - 1) / groupAlignment * groupAlignment;
+		}
 
-			// Make space for the new components
-			GroupIt<TComp> it = groups.end();
-			for (it--; it != groupIt; it--)
+		template <class TComp>
+		inline CompGroupIt<TComp> ComponentStorage<TComp>::getComponentIterator(const QueryId query)
+		{
+			// Matched archetypes follow the archetype id order, and each one gets an iterator,
+			// so all storages of a query agree on the group ids
+			// (no storage state is written, so queries can be resolved concurrently)
+			const std::vector<ArchetypeId>& archetypes = ArchetypeRegistry::getArchetypes(query);
+			CompGroupIt<TComp> groupIt(archetypes.size());
+			for (const ArchetypeId archetype : archetypes)
 			{
-				it->second->rollClockwise(count);
+				// Archetypes without entities yet (or lacking this optional type) have no group
+				GroupIt<TComp> it = findGroup(archetype);
+				if (it != groups.end())
+				{
+					groupIt.push(*it);
+				}
+				else
+				{
+					groupIt.pushEmpty();
+				}
 			}
+			return groupIt;
+		}
+
+		template <class TComp>
+		inline ComponentsGroup<TComp>* ComponentStorage<TComp>::addComponent(const ArchetypeId archetype,
+										     const TComp* comps, int32_t count)
+		{
+			return insertComponents(archetype, count,
+						[comps, count](CompGroup<TComp>* group) { group->addComponent(comps, count); });
+		}
+
+		template <class TComp>
+		inline ComponentsGroup<TComp>* ComponentStorage<TComp>::addMovedComponents(const ArchetypeId archetype,
+											   TComp* comps, int32_t count)
+		{
+			return insertComponents(archetype, count, [comps, count](CompGroup<TComp>* group) {
+				group->addMovedComponents(comps, count);
+			});
+		}
+
+		template <class TComp>
+		inline ComponentsGroup<TComp>* ComponentStorage<TComp>::fillComponent(const ArchetypeId archetype,
+										      const TComp& value, int32_t count)
+		{
+			return insertComponents(archetype, count,
+						[&value, count](CompGroup<TComp>* group) { group->fillComponent(value, count); });
+		}
+
+		template <class TComp>
+		template <class TPlacer>
+		inline ComponentsGroup<TComp>* ComponentStorage<TComp>::insertComponents(const ArchetypeId archetype,
+											 int32_t count, TPlacer&& placer)
+		{
+			GroupIt<TComp> groupIt = getComponentGroup(archetype);
+
+			// Make space for the new components (growing the storage if needed)
+			makeRoom(groupIt, count);
 
 			// Hold group reference
-			CompGroup<TComp>* group = groupIt->second;
+			CompGroup<TComp>* group = *groupIt;
 
 			// Make space for the new components in the group
 			group->shiftClockwise(count);
 
 			// Add the new components in the group
-			group->addComponent(comps, count);
+			placer(group);
+			group->changeVersion.set(ChangeTick::advance());
+			groupsChurn[groupIt - groups.begin()] += count;
 
 			// Increase Used Size
 			size += count;
+			version++;
 
 			return group;
 		}
 
 		template <class TComp>
-		inline TComp* ComponentStorage<TComp>::addComponent(const intptr_t* masks, const int32_t maskCount,
-								    const TComp& comp)
+		inline TComp* ComponentStorage<TComp>::addComponent(const ArchetypeId archetype, const TComp& comp)
 		{
-			ComponentsGroup<TComp>* group = addComponent(masks, maskCount, &comp, 1);
+			ComponentsGroup<TComp>* group = addComponent(archetype, &comp, 1);
 
 			// Return Component Reference
 			return group->getLastComponent();
 		}
 
 		template <class TComp>
-		inline GroupIt<TComp> ComponentStorage<TComp>::getComponentGroup(const intptr_t* masks,
-										 const int32_t maskCount)
+		inline GroupIt<TComp> ComponentStorage<TComp>::findGroup(const ArchetypeId archetype)
 		{
-			// Compute Group Mask
-			GroupMask mask(masks, maskCount);
+			if (archetype >= static_cast<ArchetypeId>(groupsIndex.size()) || groupsIndex[archetype] < 0)
+			{
+				return groups.end();
+			}
+			return groups.begin() + groupsIndex[archetype];
+		}
 
-			// Get existing group
-			GroupIt<TComp> it = groups.lower_bound(mask);
-			if (it != groups.end() && !(groups.key_comp()(mask, it->first)))
+		template <class TComp>
+		inline TComp* ComponentStorage<TComp>::getComponent(const ArchetypeId archetype, const int32_t groupPos,
+								    const bool markChanged)
+		{
+			// Flat lookups only, groups are indexed by archetype id
+			if (archetype >= static_cast<ArchetypeId>(groupsIndex.size()) || groupsIndex[archetype] < 0)
 			{
-				return it;
+				return nullptr;
+			}
+			CompGroup<TComp>* group = groups[groupsIndex[archetype]];
+			_ASSERT(groupPos >= 0 && groupPos < group->size);
+			if (markChanged)
+			{
+				// Stamped with a tick of its own, so the write is newer than the tick of any system update
+				// (even one running concurrently)
+				group->changeVersion.set(ChangeTick::advance());
 			}
+			return group->getComponent(groupPos);
+		}
 
-			// Creates new Group
-			it = groups.insert(it, GroupMaskPair<TComp>(mask, nullptr));
-			// Proper Initialization
-			int32_t baseOffset = 0;
-			if (it != groups.begin())
+		template <class TComp>
+		inline GroupIt<TComp> ComponentStorage<TComp>::getComponentGroup(const ArchetypeId archetype)
+		{
+			// Get existing group
+			GroupIt<TComp> it = findGroup(archetype);
+			if (it != groups.end())
 			{
-				GroupIt<TComp> lastGroupIt = it;
-				--lastGroupIt;
-				CompGroup<TComp>* lastGroup = lastGroupIt->second;
-				baseOffset = lastGroup->baseOffset + lastGroup->size;
+				return it;
 			}
-			it->second = new CompGroup<TComp>(data, baseOffset);
 
-			// Skip current ComponentType ptr
-			const intptr_t curType = (intptr_t)getInstance();
-			intptr_t* selComb = new intptr_t[maskCount - 1];
-			for (int32_t i = 0, j = 0; i < maskCount - 1; i++, j++)
+			// New groups are appended to the layout (growing at the end is the cheapest insertion)
+			const int32_t groupPos = static_cast<int32_t>(groups.size());
+			int32_t baseOffset = 0;
+			if (groupPos > 0)
 			{
-				if (masks[j] == curType)
+				// Keeping the headroom of the last group
+				CompGroup<TComp>* lastGroup = groups[groupPos - 1];
+				int32_t end = lastGroup->baseOffset + lastGroup->size;
+				if (slackPolicy.isEnabled())
 				{
-					j++;
+					end += slackPolicy.getSlack(lastGroup->size);
 				}
-				selComb[i] = masks[j];
+				baseOffset = alignGroupOffset(end);
 			}
-			// Insert Group Mask in the registry
-			GroupsRegIt regEntryIt = getRegistryEntryIt(curType);
-			regEntryIt->second.insert(mask);
-			// Insert Group Mask for all combinations
-			int32_t combCount;
-			intptr_t* combs = getMaskCombinations(selComb, maskCount - 1, combCount);
-			for (int32_t i = 0; i < combCount; i++)
+
+			// Creates new Group
+			groups.push_back(new CompGroup<TComp>(data, baseOffset));
+			groups[groupPos]->changeVersion.set(ChangeTick::advance());
+			groupsArchetype.push_back(archetype);
+			groupsChurn.push_back(0);
+			if (archetype >= static_cast<ArchetypeId>(groupsIndex.size()))
 			{
-				const intptr_t comb = curType + combs[i];
-				regEntryIt = getRegistryEntryIt(comb);
-				regEntryIt->second.insert(mask);
+				groupsIndex.resize(archetype + 1, -1);
 			}
-			delete[] combs;
-			delete[] selComb;
-			return it;
+			groupsIndex[archetype] = groupPos;
+			version++;
+
+			return groups.begin() + groupPos;
+		}
+
+		template <class TComp>
+		inline ComponentStorage<TComp>* ComponentStorage<TComp>::getInstance()
+		{
+			static ComponentStorage<TComp>* storage = new ComponentStorage<TComp>();
+			return storage;
 		}
 
 		template <class TComp>
-		inline GroupsRegIt ComponentStorage<TComp>::getRegistryEntryIt(const intptr_t mask)
+		inline void ComponentStorage<TComp>::moveComponents(const int32_t* groupPos, int32_t count,
+								    ArchetypeId srcArchetype, ArchetypeId dstArchetype)
 		{
-			// Look for registry entry
-			GroupsRegIt regIt = groupsRegistry.lower_bound(mask);
+			GroupIt<TComp> srcIt = findGroup(srcArchetype);
+			_ASSERT(srcIt != groups.end());
 
-			// Check if a registry entry exists
-			if (regIt != groupsRegistry.end() && !(groupsRegistry.key_comp()(mask, regIt->first)))
+			// Gather the moved components first, the source group is compressed on removal
+			moveBuffer.clear();
+			moveBuffer.reserve(count);
+			for (int32_t i = 0; i < count; i++)
 			{
-				return regIt;
+				moveBuffer.push_back(std::move(*(*srcIt)->getComponent(groupPos[i])));
 			}
+			removeFromGroup(srcIt, groupPos, count);
 
-			// Create a new registry set on the corret position
-			regIt = groupsRegistry.insert(regIt, GroupRegPair(mask, GroupMaskSet()));
+			// A single insertion on the destination group (one roll per group), moved again rather than copied
+			addMovedComponents(dstArchetype, moveBuffer.data(), count);
+			moveBuffer.clear();
+		}
 
-			// Returns entry
-			return regIt;
+		template <class TComp>
+		inline void ComponentStorage<TComp>::removeFromGroup(GroupIt<TComp> groupIt, const int32_t* groupPos,
+								     const int32_t count)
+		{
+			// Remove Component from specific group
+			(*groupIt)->remComponent(groupPos, count);
+			(*groupIt)->changeVersion.set(ChangeTick::advance());
+			groupsChurn[groupIt - groups.begin()] += count;
+			size -= count;
+			version++;
+			// Freed slots are kept as group slack, otherwise roll all effected groups to fill the gap
+			if (!slackPolicy.isEnabled())
+			{
+				closeGaps(groupIt);
+			}
 		}
 
 		template <class TComp>
-		inline ComponentStorage<TComp>* ComponentStorage<TComp>::getInstance()
+		inline void ComponentStorage<TComp>::removeComponent(int32_t entityId, ArchetypeId archetype)
 		{
-			static ComponentStorage<TComp>* storage = new ComponentStorage<TComp>();
-			return storage;
+			removeComponents(&entityId, 1, archetype);
 		}
 
 		template <class TComp>
-		inline void ComponentStorage<TComp>::removeComponent(int32_t entityId, GroupMask typeMask)
+		inline void ComponentStorage<TComp>::removeComponents(const int32_t* groupPos, int32_t count,
+								      ArchetypeId archetype)
 		{
-			GroupIt<TComp> it = groups.find(typeMask);
+			GroupIt<TComp> it = findGroup(archetype);
 			_ASSERT(it != groups.end());
-			// Remove Component from specific group
-			(*it->second).remComponent(&entityId, 1);
-			// Roll all effected groups to fill the gap
-			for (it++; it != groups.end(); it++)
+			removeFromGroup(it, groupPos, count);
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::removeComponents(const GroupIdList& groupIdList)
+		{
+			// Components are removed from every group first, then the gaps left behind are closed
+			// in a single pass starting at the first effected group.
+			// When the slack policy is enabled the gaps are kept as group slack (no rolls at all).
+			GroupIt<TComp> firstIt = groups.end();
+			const int32_t listSize = static_cast<int32_t>(groupIdList.size());
+			for (GroupIt<TComp> it = groups.begin(); it != groups.end(); it++)
+			{
+				const ArchetypeId archetype = groupsArchetype[it - groups.begin()];
+				if (archetype >= listSize || groupIdList[archetype].empty())
+				{
+					continue;
+				}
+
+				// Remove Component from specific group
+				const std::vector<int32_t>& entityIds = groupIdList[archetype];
+				(*it)->remComponent(entityIds.data(), entityIds.size());
+				(*it)->changeVersion.set(ChangeTick::advance());
+				groupsChurn[it - groups.begin()] += entityIds.size();
+				size -= entityIds.size();
+				if (firstIt == groups.end())
+				{
+					firstIt = it;
+				}
+			}
+			if (firstIt == groups.end())
 			{
-				(*it->second).rollCounterClockwise(1);
+				return;
+			}
+			version++;
+
+			// Fill-in the gaps left by removed components
+			if (!slackPolicy.isEnabled())
+			{
+				closeGaps(firstIt);
 			}
 		}
 
 		template <class TComp>
-		inline void ComponentStorage<TComp>::removeComponents(GroupIdList groupIdList)
+		inline void ComponentStorage<TComp>::reorderGroups()
 		{
-			// For the chuck removal we keep track of the next removal group (nextIt),
-			// This allows us to go through effected groups only once, while accumulating
-			// the roll ammount, so all groups fill-in the gaps left by removed components.
-			int32_t accRoll = 0;
-			GroupIdList::iterator beg = groupIdList.begin();
-			GroupIt<TComp> nextIt = groups.find(beg->first);
-			while (beg != groupIdList.end())
+			// Groups are ordered by churn magnitude (so small variations don't reorder them), keeping
+			// their current order on ties, then the churn is halved to follow the recent workload
+			const int32_t groupCount = static_cast<int32_t>(groups.size());
+			reorderBuffer.resize(groupCount);
+			std::iota(reorderBuffer.begin(), reorderBuffer.end(), 0);
+			std::stable_sort(reorderBuffer.begin(), reorderBuffer.end(), [this](const int32_t a, const int32_t b) {
+				return highestPowerOfTwoIn(groupsChurn[a]) < highestPowerOfTwoIn(groupsChurn[b]);
+			});
+			for (uint32_t& churn : groupsChurn)
+			{
+				churn >>= 1;
+			}
+			if (std::is_sorted(reorderBuffer.begin(), reorderBuffer.end()))
+			{
+				return;
+			}
+
+			// Final base offsets of the groups (in the new order), packed keeping the slack policy headroom
+			offsetBuffer.resize(groupCount);
+			int32_t end = 0;
+			for (int32_t i = 0; i < groupCount; i++)
 			{
-				GroupIt<TComp> it = nextIt;
-				_ASSERT(it != groups.end());
+				const CompGroup<TComp>* group = groups[reorderBuffer[i]];
+				offsetBuffer[i] = alignGroupOffset(end);
+				end = offsetBuffer[i] + group->size;
+				if (slackPolicy.isEnabled())
+				{
+					end += slackPolicy.getSlack(group->size);
+				}
+			}
+			reserve(end);
 
-				// Remove Component from specific group
-				std::vector<int>* entityIds = beg->second;
-				int32_t roll = (*it->second).remComponent(entityIds->data(), entityIds->size());
-				
-				// Fill-in the gaps for the group whose components have been removed
-				(*it->second).rollCounterClockwise(accRoll);
-				accRoll += roll; // Accumulate the gaps for multiple groups removal
-				
-				// Get next group mask
-				beg++;
-				// And get next group it
-				nextIt = (beg == groupIdList.end()) ? groups.end() : groups.find(beg->first);
-
-				// Roll all effected groups to fill the gap (until next group removal)
-				for (it++; it != nextIt; it++)
+			// Groups are permuted in place, so there is no scratch copy of the storage: every group is first
+			// packed unrolled (no gaps, so rotations only touch live components), then each group is rotated
+			// into its new place, then the groups are spread to their final offsets (from right to left)
+			for (int32_t i = 0; i < groupCount; i++)
+			{
+				reorderBuffer[i] = groupsArchetype[reorderBuffer[i]];
+			}
+			int32_t packedEnd = 0;
+			for (CompGroup<TComp>* group : groups)
+			{
+				group->rollCounterClockwise(group->baseOffset - packedEnd);
+				std::rotate(group->dataPos(), group->dataPos() + group->tipOffset, group->dataPos() + group->size);
+				group->tipOffset = 0;
+				packedEnd = group->baseOffset + group->size;
+			}
+			for (int32_t i = 0; i < groupCount; i++)
+			{
+				const int32_t groupPos = static_cast<int32_t>(
+				    std::find(groupsArchetype.begin() + i, groupsArchetype.end(), reorderBuffer[i]) -
+				    groupsArchetype.begin());
+				if (groupPos == i)
 				{
-					(*it->second).rollCounterClockwise(accRoll);
+					continue;
 				}
+
+				// The groups in between are moved right by the size of the rotated group
+				CompGroup<TComp>* group = groups[groupPos];
+				const int32_t base = groups[i]->baseOffset;
+				std::rotate(data + base, group->dataPos(), group->dataPos() + group->size);
+				for (int32_t j = i; j < groupPos; j++)
+				{
+					groups[j]->baseOffset += group->size;
+				}
+				group->baseOffset = base;
+				std::rotate(groups.begin() + i, groups.begin() + groupPos, groups.begin() + groupPos + 1);
+				std::rotate(groupsArchetype.begin() + i, groupsArchetype.begin() + groupPos,
+					    groupsArchetype.begin() + groupPos + 1);
+				std::rotate(groupsChurn.begin() + i, groupsChurn.begin() + groupPos,
+					    groupsChurn.begin() + groupPos + 1);
+			}
+			for (int32_t i = groupCount - 1; i >= 0; i--)
+			{
+				CompGroup<TComp>* group = groups[i];
+				rv::moveComponents(data + offsetBuffer[i], group->dataPos(), group->size);
+				group->baseOffset = offsetBuffer[i];
+				groupsIndex[groupsArchetype[i]] = i;
+			}
+			version++;
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::unrollGroups()
+		{
+			bool unrolled = false;
+			for (CompGroup<TComp>* group : groups)
+			{
+				if (group->tipOffset == 0)
+				{
+					continue;
+				}
+
+				// The first component (at the tip) is rotated back to the group base
+				std::rotate(group->dataPos(), group->dataPos() + group->tipOffset, group->dataPos() + group->size);
+				group->tipOffset = 0;
+				unrolled = true;
+			}
+			if (unrolled)
+			{
+				version++;
+			}
+		}
+
+		template <class TComp>
+		inline bool ComponentStorage<TComp>::compact(size_t& budget)
+		{
+			bool compacted = false;
+			const int32_t groupCount = static_cast<int32_t>(groups.size());
+			for (; compactCursor < groupCount; compactCursor++)
+			{
+				if (budget == 0)
+				{
+					break;
+				}
+
+				// Shrink the gap before this group down to the headroom of the previous group
+				CompGroup<TComp>* group = groups[compactCursor];
+				int32_t base = 0;
+				if (compactCursor > 0)
+				{
+					const CompGroup<TComp>* prevGroup = groups[compactCursor - 1];
+					int32_t end = prevGroup->baseOffset + prevGroup->size;
+					if (slackPolicy.isEnabled())
+					{
+						end += slackPolicy.getSlack(prevGroup->size);
+					}
+					base = alignGroupOffset(end);
+				}
+				int32_t moved = 0;
+				if (group->baseOffset > base)
+				{
+					const int32_t shift = group->baseOffset - base;
+					group->rollCounterClockwise(shift);
+					moved += min(shift, group->size);
+				}
+
+				// Then rotate its first component (at the tip) back to its base
+				if (group->tipOffset != 0)
+				{
+					std::rotate(group->dataPos(), group->dataPos() + group->tipOffset,
+						    group->dataPos() + group->size);
+					group->tipOffset = 0;
+					moved += group->size;
+				}
+
+				if (moved > 0)
+				{
+					const size_t bytes = moved * sizeof(TComp);
+					budget -= (bytes < budget) ? bytes : budget;
+					compacted = true;
+				}
+			}
+			if (compacted)
+			{
+				version++;
 			}
+
+			// The next pass starts over from the first group
+			if (compactCursor < groupCount)
+			{
+				return false;
+			}
+			compactCursor = 0;
+			return true;
+		}
+
+		template <class TComp>
+		inline void ComponentStorage<TComp>::shrinkToFit()
+		{
+			shrink(0.0f);
 		}
 
 	} // namespace
@@ -0,0 +1,140 @@
+#ifndef COMPONENTTRAITS_H
+#define COMPONENTTRAITS_H
+
+#include <stddef.h>
+#include <type_traits>
+
+namespace rv
+{
+
+	/**
+	 * @brief Either or not the storage of a component type is backed by paged virtual memory.
+	 * A paged storage reserves a large address range up-front and commits pages as it grows,
+	 * so its data pointer never changes and growing never copies (nor doubles) the components memory.
+	 * Opt-in by specializing it: template <> struct rv::UsePagedStorage<MyComp> : std::true_type {};
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct UsePagedStorage : std::false_type
+	{
+	};
+
+	/**
+	 * @brief Size of the address range (in bytes) reserved by a paged storage,
+	 * which is the upper limit of its capacity.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct PagedStorageReserve
+	    : std::integral_constant<size_t, (sizeof(void*) >= 8) ? (size_t(1) << 35) : (size_t(1) << 28)>
+	{
+	};
+
+	/**
+	 * @brief Either or not a component type can be relocated through raw memory copies.
+	 * Storage operations (rolls, shifts, compressions and growth) use memcpy/memmove for these types,
+	 * other types are relocated through move construction followed by destruction of the source.
+	 * Defaults to trivially copyable types, specialize it for types that are safe to relocate bitwise.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct IsTriviallyRelocatable : std::is_trivially_copyable<TComp>
+	{
+	};
+
+	/**
+	 * @brief Alignment (in bytes) of the data block of a component storage.
+	 * Defaults to the cache line size, so the storage never shares its first line and vector loads
+	 * from the start of the block are aligned. Must be a power of two.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct ComponentAlignment : std::integral_constant<size_t, 64>
+	{
+	};
+
+	/**
+	 * @brief Alignment (in bytes) of the group base offsets inside a component storage.
+	 * Groups are padded so their first slot starts at a multiple of this alignment (e.g. 32 for AVX),
+	 * defaults to no padding. Must be a power of two.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct GroupAlignment : std::integral_constant<size_t, 1>
+	{
+	};
+
+	/**
+	 * @brief Marks a system component type as optional, e.g. BaseSystem<Position, Optional<const Velocity>>.
+	 * Optional types don't restrict the matched archetypes, their chunk pointers are nullptr
+	 * for the archetypes that lack them.
+	 *
+	 * @tparam TComp Type of the component (possibly const-qualified).
+	 */
+	template <typename TComp>
+	struct Optional
+	{
+	};
+
+	/**
+	 * @brief Either or not a system component type is optional.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct IsOptional : std::false_type
+	{
+	};
+
+	template <typename TComp>
+	struct IsOptional<Optional<TComp>> : std::true_type
+	{
+	};
+
+	template <typename TComp>
+	struct QueriedComponentType
+	{
+		using type = TComp;
+	};
+
+	template <typename TComp>
+	struct QueriedComponentType<Optional<TComp>>
+	{
+		using type = TComp;
+	};
+
+	/**
+	 * @brief Component type a system chunk pointer points to (without the Optional marker).
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	using QueriedComponent = typename QueriedComponentType<TComp>::type;
+
+	/**
+	 * @brief Component type kept by the storage of a (possibly const-qualified or optional) system component type.
+	 * Systems list read-only components as const types, e.g. BaseSystem<const Velocity, Position>.
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	using StoredComponent = std::remove_const_t<QueriedComponent<TComp>>;
+
+	/**
+	 * @brief Either or not a system component type is only read (const-qualified).
+	 *
+	 * @tparam TComp Type of the component.
+	 */
+	template <typename TComp>
+	struct IsReadOnly : std::is_const<QueriedComponent<TComp>>
+	{
+	};
+
+} // namespace rv
+
+#endif
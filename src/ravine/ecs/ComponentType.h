@@ -0,0 +1,106 @@
+#ifndef COMPONENTTYPE_H
+#define COMPONENTTYPE_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+namespace rv
+{
+	typedef int32_t ComponentTypeId;
+	static constexpr ComponentTypeId InvalidComponentType = -1;
+
+	class IComponentStorage;
+
+	/**
+	 * @brief Assigns each component type a dense id and keeps a flat table of their storages.
+	 * Ids are assigned on first use (in first use order), so they are valid even when read by other static
+	 * initializers, e.g. systems declared at namespace scope. Each type keeps its id in a constant-initialized
+	 * atomic, so reading an assigned id is a single acquire load (a plain load on x86) without static guards.
+	 * Assignments are serialized by a lock, so types first used concurrently still get distinct ids.
+	 */
+	class ComponentTypeRegistry
+	{
+		/**
+		 * @brief Id of a component type (InvalidComponentType until its first use).
+		 */
+		template <class TComp>
+		struct TypeIdSlot
+		{
+			inline static std::atomic<ComponentTypeId> id{InvalidComponentType};
+		};
+
+		/**
+		 * @brief Amount of registered component types.
+		 */
+		static std::atomic<ComponentTypeId> typeCount;
+
+		/**
+		 * @brief Serializes the assignment of new type ids.
+		 */
+		static std::mutex typeIdMutex;
+
+		/**
+		 * @brief Storage of each component type (indexed by type id), set once the type is part of an archetype.
+		 */
+		static std::vector<IComponentStorage*> storages;
+
+	  public:
+		/**
+		 * @brief Returns the dense id of a component type, assigning it on first use.
+		 *
+		 * @tparam TComp Type of the component.
+		 */
+		template <class TComp>
+		inline static ComponentTypeId typeId()
+		{
+			const ComponentTypeId id = TypeIdSlot<TComp>::id.load(std::memory_order_acquire);
+			return (id != InvalidComponentType) ? id : assignTypeId(TypeIdSlot<TComp>::id);
+		}
+
+		inline static ComponentTypeId getTypeCount() { return typeCount.load(std::memory_order_acquire); }
+
+		/**
+		 * @brief Returns the storage of a component type (nullptr if none of its archetypes has been created).
+		 */
+		inline static IComponentStorage* getStorage(const ComponentTypeId type)
+		{
+			return (type < static_cast<ComponentTypeId>(storages.size())) ? storages[type] : nullptr;
+		}
+
+		inline static void setStorage(const ComponentTypeId type, IComponentStorage* storage)
+		{
+			if (type >= static_cast<ComponentTypeId>(storages.size()))
+			{
+				storages.resize(type + 1, nullptr);
+			}
+			storages[type] = storage;
+		}
+
+	  private:
+		/**
+		 * @brief Assigns the next id to a type slot, unless another thread assigned it first.
+		 */
+		inline static ComponentTypeId assignTypeId(std::atomic<ComponentTypeId>& slot)
+		{
+			std::lock_guard<std::mutex> lock(typeIdMutex);
+			ComponentTypeId id = slot.load(std::memory_order_relaxed);
+			if (id == InvalidComponentType)
+			{
+				id = typeCount.load(std::memory_order_relaxed);
+				slot.store(id, std::memory_order_release);
+				typeCount.store(id + 1, std::memory_order_release);
+			}
+			return id;
+		}
+	};
+
+	// Static Definitions
+	inline std::atomic<ComponentTypeId> ComponentTypeRegistry::typeCount{0};
+	inline std::mutex ComponentTypeRegistry::typeIdMutex;
+	inline std::vector<IComponentStorage*> ComponentTypeRegistry::storages;
+
+} // namespace rv
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef COMPONENTS_GROUP_HPP
 #define COMPONENTS_GROUP_HPP
 
+#include "ChangeTick.h"
+#include "ComponentRelocation.h"
 #include "Entity.hpp"
 #include "FastMath.h"
 
@@ -16,6 +18,11 @@ namespace rv
 		int32_t baseOffset = 0;
 		int32_t size = 0;
 		int32_t tipOffset = 0;
+		/**
+		 * @brief Tick of the last write to this group (\see{ChangeTick}), either by a system
+		 * with mutable access or by components being added or removed.
+		 */
+		ChangeVersion changeVersion;
 
 		/**
 		 * @brief Constructs a group from a storage data array pointer reference
@@ -35,6 +42,22 @@ namespace rv
 		 */
 		inline void addComponent(const TComponent* comps, const uint32_t count);
 
+		/**
+		 * @brief Batch adding of components to this group, moving them instead of copying.
+		 *
+		 * @param comps Component data array to move from (left moved-from).
+		 * @param count Amount of components in the array.
+		 */
+		inline void addMovedComponents(TComponent* comps, const uint32_t count);
+
+		/**
+		 * @brief Batch adding of copies of a single component to this group.
+		 *
+		 * @param value Component data to copy from.
+		 * @param count Amount of components to add.
+		 */
+		inline void fillComponent(const TComponent& value, const uint32_t count);
+
 		/**
 		 * @brief Adds a single component to this group.
 		 *
@@ -101,10 +124,43 @@ namespace rv
 		// TODO: Implement Shift CounterClockwise
 		// TODO: Implement Swap of Components
 		// TODO: Implement InsertComponent (on a specific location)
+
+	  private:
+		/**
+		 * @brief Places new components before the tip and at the group end, they are constructed by
+		 * *place(dst, first, count)*, with *first* being the position of *dst* among the new components.
+		 */
+		template <class TPlacer>
+		inline void placeComponents(const uint32_t count, TPlacer&& place);
 	};
 
 	template <class TComponent>
 	inline void ComponentsGroup<TComponent>::addComponent(const TComponent* comps, const uint32_t count)
+	{
+		placeComponents(count, [comps](TComponent* dst, const int32_t first, const int32_t placed) {
+			copyComponents(dst, comps + first, placed);
+		});
+	}
+
+	template <class TComponent>
+	inline void ComponentsGroup<TComponent>::addMovedComponents(TComponent* comps, const uint32_t count)
+	{
+		placeComponents(count, [comps](TComponent* dst, const int32_t first, const int32_t placed) {
+			moveConstructComponents(dst, comps + first, placed);
+		});
+	}
+
+	template <class TComponent>
+	inline void ComponentsGroup<TComponent>::fillComponent(const TComponent& value, const uint32_t count)
+	{
+		placeComponents(count, [&value](TComponent* dst, const int32_t, const int32_t placed) {
+			fillComponents(dst, value, placed);
+		});
+	}
+
+	template <class TComponent>
+	template <class TPlacer>
+	inline void ComponentsGroup<TComponent>::placeComponents(const uint32_t count, TPlacer&& place)
 	{
 		const int32_t missLeft = tipOffset - count;
 		// If there is any missing slots left of the tip
@@ -114,11 +170,11 @@ namespace rv
 		// Left count is either the whole space until the tip or the count of comps
 		// (when there is no missing slots left of the tip)
 		const int32_t leftCount = rightMask * tipOffset + (1 - rightMask) * count;
-		
+
 		// Add components at group end
-		memcpy(dataPos() + size, comps + 0, rightCount * sizeof(TComponent));
+		place(dataPos() + size, 0, rightCount);
 		// Add components before tip
-		memcpy(dataPos() + tipOffset - leftCount, comps + rightCount, leftCount * sizeof(TComponent));
+		place(dataPos() + tipOffset - leftCount, rightCount, leftCount);
 		size += rightCount;
 	}
 
@@ -134,6 +190,15 @@ namespace rv
 		const int32_t rightSize = size - tipOffset;
 		int32_t leftComprCount = 0;
 
+		// Destroy removed components, their slots are filled by the compressions
+		if constexpr (!std::is_trivially_destructible<TComponent>::value)
+		{
+			for (int32_t i = 0; i < count; i++)
+			{
+				destroyComponents(getComponent(compPos[i]), 1);
+			}
+		}
+
 		// Count the number of left compressions
 		for (int32_t i = 0; i < count; i++)
 		{
@@ -143,7 +208,8 @@ namespace rv
 		// Count the number of right compressions
 		int32_t rightComprCount = count - leftComprCount;
 
-		// Compress left all elements right of the tip
+		// Compress left all elements right of the tip (vacated slots at the end are not moved again)
+		int32_t tailPos = size;
 		for (int32_t i = leftComprCount - 1; i >= 0; i--)
 		{
 			const int32_t cId = i;
@@ -167,16 +233,18 @@ namespace rv
 			const int32_t actualPos = tipOffset + comprPos;
 
 			// Calculate amount of elements to be compressed left
-			const int32_t comprCount = size - actualPos - 1;
+			const int32_t comprCount = tailPos - actualPos - 1;
 
 			// Perform compression by moving memory blocks
 			const int32_t srcPos = actualPos + 1;
 			const int32_t dstPos = srcPos - comprShifts;
-			memmove(dataPos() + dstPos, dataPos() + srcPos, comprCount * sizeof(TComponent));
+			moveComponents(dataPos() + dstPos, dataPos() + srcPos, comprCount);
+			tailPos -= comprShifts;
 		}
 		size -= leftComprCount;
 
-		// Compress right all elements left of the tip
+		// Compress right all elements left of the tip (vacated slots at the start are not moved again)
+		int32_t headPos = 0;
 		for (int32_t i = leftComprCount; i < count; i++)
 		{
 			const int32_t cId = i;
@@ -197,10 +265,11 @@ namespace rv
 			}
 
 			// Calculate amount of elements to be compressed right
-			const int32_t comprCount = comprPos - rightSize;
+			const int32_t comprCount = comprPos - rightSize - headPos;
 
 			// Perform compression by moving memory blocks
-			memmove(dataPos() + comprShifts, dataPos(), comprCount * sizeof(TComponent));
+			moveComponents(dataPos() + headPos + comprShifts, dataPos() + headPos, comprCount);
+			headPos += comprShifts;
 		}
 		baseOffset += rightComprCount;
 		tipOffset -= rightComprCount;
@@ -215,7 +284,9 @@ namespace rv
 	template <class TComponent>
 	inline TComponent* ComponentsGroup<TComponent>::getComponent(const int32_t compId)
 	{
-		return dataPos() + (tipOffset + compId) % size;
+		// Both the tip and the id are below the size, so a single wrap is enough (no division)
+		const int32_t pos = tipOffset + compId;
+		return dataPos() + pos - size * (1 - signMask(pos - size));
 	}
 
 	template <class TComponent>
@@ -229,9 +300,9 @@ namespace rv
 	{
 		const int32_t toCopy = min(size, count);
 		const int32_t stride = max(size, count);
-		memcpy(dataPos() + stride, dataPos(), toCopy * sizeof(TComponent)); // Roll data
-		tipOffset -= toCopy;						    // Decrease tipOffset
-		tipOffset += signMask(tipOffset) * size;			    // Wrap around
+		relocateComponents(dataPos() + stride, dataPos(), toCopy); // Roll data
+		tipOffset -= toCopy;					   // Decrease tipOffset
+		tipOffset += signMask(tipOffset) * size;		   // Wrap around
 
 		// Should Increase base ptr
 		baseOffset += count;
@@ -245,10 +316,10 @@ namespace rv
 		const int32_t srcPos = size - toCopy;
 		TComponent* dst = dataPos() - dstOffset;
 		TComponent* src = dataPos() + srcPos;
-		memcpy(dst, src, toCopy * sizeof(TComponent));	    // Roll data
+		relocateComponents(dst, src, toCopy);		    // Roll data
 		tipOffset += toCopy;				    // Increase tipOffset
 		tipOffset -= signMask(size - tipOffset - 1) * size; // Wrap around
-		baseOffset -= toCopy;				    // Decrease base ptr
+		baseOffset -= dstOffset;			    // Decrease base ptr
 	}
 
 	template <class TComponent>
@@ -258,8 +329,8 @@ namespace rv
 		const int32_t mask = signMask(count - tipOffset - 1);
 		const int32_t shiftCount = (tipOffset - count) * mask;
 		const int32_t rollCount = count * mask;
-		memcpy(dataPos() + size, dataPos(), rollCount * sizeof(TComponent));	   // Roll data
-		memcpy(dataPos(), dataPos() + rollCount, shiftCount * sizeof(TComponent)); // Shift data
+		relocateComponents(dataPos() + size, dataPos(), rollCount);   // Roll data
+		moveComponents(dataPos(), dataPos() + rollCount, shiftCount); // Shift data
 		size += count; // Increases size to update end of array
 		return count;  // Returns how many slots left before tip
 	}
@@ -270,47 +341,6 @@ namespace rv
 		return data + baseOffset;
 	}
 
-	/**
-	 * @brief Struct that represents the hash of component types.
-	 */
-	struct GroupMask
-	{
-		/**
-		 * @brief Hash of all pointer types this mask represents.
-		 */
-		intptr_t typePtr;
-		/**
-		 * @brief Amount of types this mask represents.
-		 */
-		int32_t typesCount;
-
-		inline GroupMask(const intptr_t* masks, const int32_t count) : typePtr(0), typesCount(count)
-		{
-			for (size_t i = 0; i < typesCount; i++)
-			{
-				typePtr += masks[i];
-			}
-		}
-	};
-
-	/**
-	 * @brief Group Mask Compare operation.
-	 */
-	struct GroupMaskCmp
-	{
-		inline bool operator()(const GroupMask& a, const GroupMask& b) const
-		{
-			if (a.typesCount != b.typesCount)
-			{
-				return a.typesCount > b.typesCount;
-			}
-			else
-			{
-				return a.typePtr < b.typePtr;
-			}
-		}
-	};
-
 } // namespace rv
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef COMPONENTSITERATOR_HPP
 #define COMPONENTSITERATOR_HPP
 
+#include <utility>
+
 #include "ComponentsGroup.hpp"
 
 namespace rv
@@ -12,54 +14,155 @@ namespace rv
 		TComp* data;
 		int32_t lSize;
 		int32_t rSize;
+		ChangeVersion* changeVersion;
 
 	  public:
-		constexpr CompIt() : data(nullptr), lSize(0), rSize(0) {}
-		constexpr CompIt(TComp* data, int32_t offset, int32_t size)
-		    : data(data), lSize(offset), rSize(size - offset)
+		constexpr CompIt() : data(nullptr), lSize(0), rSize(0), changeVersion(nullptr) {}
+		constexpr CompIt(TComp* data, int32_t offset, int32_t size, ChangeVersion* changeVersion)
+		    : data(data), lSize(offset), rSize(size - offset), changeVersion(changeVersion)
 		{
 		}
 		inline ~CompIt() {}
 
 		constexpr int32_t getSize() const { return lSize + rSize; }
 
-		TComp* const getChunk(int32_t id, int32_t& size)
+		/**
+		 * @brief Either or not the group is a single contiguous span (its tip is at its base, or it is missing).
+		 */
+		constexpr bool isContiguous() const { return lSize == 0; }
+
+		/**
+		 * @brief Returns the component at 'id' of a contiguous group (nullptr when the group is missing).
+		 */
+		inline TComp* getSpan(const int32_t id) const { return (data != nullptr) ? data + id : nullptr; }
+
+		/**
+		 * @brief Tick of the last write to the iterated group (0 when the storage has no such group).
+		 */
+		inline uint64_t getChangeVersion() const { return (changeVersion != nullptr) ? changeVersion->get() : 0; }
+
+		/**
+		 * @brief Stamps the iterated group as written at the given tick.
+		 */
+		inline void markChanged(const uint64_t tick)
+		{
+			if (changeVersion != nullptr)
+			{
+				changeVersion->set(tick);
+			}
+		}
+
+		TComp* getChunk(int32_t id, int32_t& size)
 		{
+			// Missing groups (optional components) yield null chunks that never limit the chunk size
+			if (data == nullptr)
+			{
+				size = INT32_MAX;
+				return nullptr;
+			}
+
+			// Chunk size is the amount of contiguous slots left from 'id' (on the right or left part)
 			if (id < rSize)
 			{
-				size = rSize;
+				size = rSize - id;
 				return &data[lSize + id];
 			}
 			else // (id >= rSize)
 			{
-				size = lSize;
+				size = lSize + rSize - id;
 				return &data[id - rSize];
 			}
 		}
 	};
 
 	// TODO: Rename to GroupQuery
+	/**
+	 * @brief Query result holding one iterator per matched group.
+	 * Small queries are kept in an inline buffer (allocation-free), larger ones spill to the heap.
+	 * Move-only, as it might own its heap buffer.
+	 */
 	template <typename TComp>
 	struct CompGroupIt
 	{
-		// Iterator Group Fields
-		CompIt<TComp> compIt[50];
+	  private:
+		/**
+		 * @brief Amount of group iterators stored inline.
+		 */
+		static constexpr int32_t inlineCapacity = 8;
+
+		// Inline Group Fields
+		CompIt<TComp> inlineIts[inlineCapacity];
+		// Spilled Group Fields (when count exceeds the inline capacity)
+		CompIt<TComp>* heapIts;
+
+	  public:
 		// Current Group Count
-		uint8_t count;
+		int32_t count;
+
+		constexpr CompGroupIt() : heapIts(nullptr), count(0) {}
 
-		constexpr CompGroupIt() : count(0) {}
+		/**
+		 * @brief Constructs an empty query result, able to hold up to *capacity* groups.
+		 */
+		inline explicit CompGroupIt(const int32_t capacity) : heapIts(nullptr), count(0)
+		{
+			if (capacity > inlineCapacity)
+			{
+				heapIts = new CompIt<TComp>[capacity];
+			}
+		}
+
+		CompGroupIt(const CompGroupIt&) = delete;
+		CompGroupIt& operator=(const CompGroupIt&) = delete;
 
-		inline CompGroupIt(ComponentsGroup<TComp>** groups, const int32_t groupCount, TComp* data)
-		    : count(groupCount)
+		inline CompGroupIt(CompGroupIt&& other) noexcept : heapIts(nullptr), count(0)
 		{
-			for (uint8_t i = 0; i < count; i++)
+			*this = std::move(other);
+		}
+
+		inline CompGroupIt& operator=(CompGroupIt&& other) noexcept
+		{
+			if (this != &other)
 			{
-				const ComponentsGroup<TComp>* group = groups[i];
-				compIt[i] =
-				    CompIt<TComp>(group->data + group->baseOffset, group->tipOffset, group->size);
+				delete[] heapIts;
+				heapIts = other.heapIts;
+				count = other.count;
+				if (heapIts == nullptr)
+				{
+					for (int32_t i = 0; i < count; i++)
+					{
+						inlineIts[i] = other.inlineIts[i];
+					}
+				}
+				other.heapIts = nullptr;
+				other.count = 0;
 			}
+			return *this;
 		}
-		~CompGroupIt() { count = -1; }
+
+		~CompGroupIt()
+		{
+			delete[] heapIts;
+			count = 0;
+		}
+
+		inline CompIt<TComp>* begin() { return (heapIts != nullptr) ? heapIts : inlineIts; }
+
+		inline CompIt<TComp>& operator[](const int32_t groupId) { return begin()[groupId]; }
+
+		/**
+		 * @brief Appends the iterator of a group (within the capacity given on construction).
+		 */
+		inline void push(ComponentsGroup<TComp>* group)
+		{
+			begin()[count++] = CompIt<TComp>(group->data + group->baseOffset, group->tipOffset, group->size,
+							  &group->changeVersion);
+		}
+
+		/**
+		 * @brief Appends an empty iterator, standing for a group the storage doesn't have.
+		 */
+		inline void pushEmpty() { begin()[count++] = CompIt<TComp>(); }
 	};
 } // namespace rv
 
@@ -5,15 +5,68 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "ComponentType.h"
+
 namespace rv
 {
-	typedef uint32_t Entity;
-	static constexpr Entity InvalidEntity = UINT32_MAX;
+	/**
+	 * @brief Entity handle, holds the Entity Registry slot index on its lower bits and the slot generation
+	 * on its upper bits, so handles to a recycled slot can be told apart from the current one.
+	 * A slot is retired (never recycled again) once its generation saturates, so generations never wrap.
+	 */
+	typedef uint64_t Entity;
+	static constexpr Entity InvalidEntity = UINT64_MAX;
+
+	static constexpr uint32_t EntityIndexBits = 32;
+	static constexpr uint32_t EntityIndexMask = UINT32_MAX;
+	static constexpr uint32_t EntityGenerationMask = UINT32_MAX;
+
+	/**
+	 * @brief Maximum amount of Entity Registry slots, slots are addressed (and linked) by int32 positions.
+	 */
+	static constexpr uint32_t MaxEntityCount = INT32_MAX;
+
+	/**
+	 * @brief Generation of retired Entity Registry slots, no handle is ever made with it.
+	 */
+	static constexpr uint32_t RetiredGeneration = EntityGenerationMask;
+
+	constexpr uint32_t entityIndex(const Entity entity) { return static_cast<uint32_t>(entity & EntityIndexMask); }
+
+	constexpr uint32_t entityGeneration(const Entity entity) { return static_cast<uint32_t>(entity >> EntityIndexBits); }
+
+	constexpr Entity makeEntity(const uint32_t index, const uint32_t generation)
+	{
+		return index | (static_cast<Entity>(generation) << EntityIndexBits);
+	}
+
+	typedef int32_t ArchetypeId;
+	static constexpr ArchetypeId InvalidArchetype = -1;
+
+	/**
+	 * @brief Entity handles returned by batch creation operations, in the order of the given components.
+	 * Batches recycle freed Entity Registry entries first, so the handles are not a contiguous range of ids.
+	 * They are kept on a buffer owned by the registry, valid until the next batch creation.
+	 */
+	struct EntityRange
+	{
+		/**
+		 * @brief Entity handles of the batch.
+		 */
+		const Entity* entities = nullptr;
+
+		/**
+		 * @brief Amount of Entities in the range.
+		 */
+		int32_t count = 0;
+
+		constexpr Entity operator[](const int32_t id) const { return entities[id]; }
+	};
 
 	struct EntityProxy
 	{
 		/**
-		 * @brief The Unique Entity handle, matches it's position in the Entity Registry.
+		 * @brief The Unique Entity handle, its index matches it's position in the Entity Registry.
 		 */
 		Entity entityId = InvalidEntity;
 
@@ -26,57 +79,48 @@ namespace rv
 		/**
 		 * @brief Either or not this proxy is being tracked by the registry.
 		 */
-		constexpr bool IsTracked() { return entityId != InvalidEntity; }
+		constexpr bool IsTracked() const { return entityId != InvalidEntity; }
 	};
 
+	/**
+	 * @brief Entity Registry entry, the Entity handle index is its position in the registry and its component
+	 * types list is kept once per archetype (see ArchetypeRegistry), so entries are plain 12 byte records.
+	 * Free entries are linked together (through their group position) to be recycled.
+	 */
 	struct EntityReg
 	{
-		/**
-		 * @brief The Unique Entity handle, matches it's position in the Entity Registry.
-		 */
-		Entity entityId;
 		/**
 		 * @brief The Group position of this Entity, it is relative to it's archtype storage group,
 		 * all components of this entity will be stored at the same relative group position id.
+		 * It is -1 until the Entity components are stored (e.g. while its creation is deferred).
+		 * On free entries, it holds the index of the next free entry (-1 if none).
 		 */
-		int32_t groupPos;
+		int32_t groupPos = -1;
+		/**
+		 * @brief The archetype of this Entity (its exact component types list), invalid when the entry is free.
+		 */
+		ArchetypeId archetype = InvalidArchetype;
+		/**
+		 * @brief Generation of this entry, incremented each time it is freed (stale handles don't match it).
+		 * Entries are retired once it reaches \see{RetiredGeneration}.
+		 */
+		uint32_t generation = 0;
+	};
+	static_assert(sizeof(EntityReg) == 12, "EntityReg is expected to be 12 bytes");
+
+	/**
+	 * @brief Order in which freed Entity Registry entries are recycled.
+	 */
+	enum class SlotReuse
+	{
 		/**
-		 * @brief Amount of component types registered for this Entity.
+		 * @brief Oldest freed entry first (spreads generation increments across entries).
 		 */
-		int32_t typesCount;
+		Fifo,
 		/**
-		 * @brief Array that holds the component types.
+		 * @brief Most recently freed entry first (keeps recently used, cache-warm, entries in play).
 		 */
-		intptr_t* compTypes;
-
-		constexpr EntityReg() : entityId(InvalidEntity), groupPos(-1), typesCount(0), compTypes(nullptr) {}
-
-		EntityReg(const EntityReg& other)
-		    : entityId(other.entityId), groupPos(other.groupPos), typesCount(other.typesCount)
-		{
-			compTypes = new intptr_t[typesCount];
-			memcpy(compTypes, other.compTypes, sizeof(intptr_t) * typesCount);
-		}
-
-		EntityReg(EntityReg&& other)
-		    : entityId(other.entityId), groupPos(other.groupPos), typesCount(other.typesCount),
-		      compTypes(other.compTypes)
-		{
-			other.entityId = InvalidEntity;
-			other.groupPos = -1;
-			other.typesCount = 0;
-			other.compTypes = nullptr;
-		}
-
-		~EntityReg()
-		{
-			entityId = InvalidEntity;
-			groupPos = -1;
-			typesCount = 0;
-			delete[] compTypes;
-		}
-
-		void print() { fprintf(stdout, "Entity(%i)", entityId); }
+		Lifo
 	};
 
 } // namespace rv
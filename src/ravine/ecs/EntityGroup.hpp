@@ -14,12 +14,12 @@ namespace rv
 {
 	struct EntityLookup
 	{
-		uint32_t entityId;
+		Entity entityId;
 		int32_t groupPos;
-
-		inline bool operator<(const EntityLookup& other) { return entityId < other.entityId; }
 	};
 
+	using LookupList = std::vector<EntityLookup>;
+
 	template <>
 	struct ComponentsGroup<EntityProxy>
 	{
@@ -29,7 +29,15 @@ namespace rv
 		int32_t baseOffset = 0;
 		int32_t size = 0;
 		int32_t tipOffset = 0;
-		LookupList lookupBuffer;
+		/**
+		 * @brief Tick of the last write to this group (\see{ChangeTick}).
+		 */
+		ChangeVersion changeVersion;
+		/**
+		 * @brief Group position changes of tracked entities, shared by all Entity Proxy groups so they are
+		 * applied in a single pass (in order, so the latest position of an entity wins).
+		 */
+		static LookupList lookupBuffer;
 
 		/**
 		 * @brief Constructs a group from a storage data array pointer reference
@@ -49,6 +57,14 @@ namespace rv
 		 */
 		inline void addComponent(const EntityProxy* comps, const uint32_t count);
 
+		/**
+		 * @brief Batch adding of components to this group, proxies are trivial so they are copied.
+		 *
+		 * @param comps Component data array to copy from.
+		 * @param count Amount of components in the array.
+		 */
+		inline void addMovedComponents(EntityProxy* comps, const uint32_t count) { addComponent(comps, count); }
+
 		/**
 		 * @brief Adds a single component to this group.
 		 *
@@ -124,20 +140,14 @@ namespace rv
 		// (when there is no missing slots left of the tip)
 		const int32_t leftCount = rightMask * tipOffset + (1 - rightMask) * count;
 
-		// Pre-allocate lookup buffer
-		lookupBuffer.reserve(lookupBuffer.size() + rightCount + leftCount);
-
 		// Copy new components to their correct spots
 		EntityProxy* dst = dataPos() + size;
 		memcpy(dst, comps + 0, rightCount * sizeof(EntityProxy)); // Copy to the end of the group
 		for (int32_t i = 0; i < rightCount; i++)		  // Update EntityProxy IDs
 		{
 			EntityProxy& entity = dst[i];
-			entity.groupPos = size + i;
-
-			// TODO: Check if we can keep track only of entities the user wants to
-			// Pay for what you use
-			// if (entity.IsTracked())
+			entity.groupPos = size - tipOffset + i;
+			if (entity.IsTracked())
 			{
 				lookupBuffer.push_back({entity.entityId, entity.groupPos});
 			}
@@ -149,10 +159,7 @@ namespace rv
 		{
 			EntityProxy& entity = dst[i];
 			entity.groupPos = size - leftCount + rightCount + i;
-
-			// TODO: Check if we can keep track only of entities the user wants to
-			// Pay for what you use
-			// if (entity.IsTracked())
+			if (entity.IsTracked())
 			{
 				lookupBuffer.push_back({entity.entityId, entity.groupPos});
 			}
@@ -164,6 +171,11 @@ namespace rv
 
 	inline int32_t ComponentsGroup<EntityProxy>::remComponent(const int32_t* compPos, const int32_t count)
 	{
+		if (count <= 0)
+		{
+			return 0;
+		}
+
 		const int32_t rightSize = size - tipOffset;
 		int32_t leftComprCount = 0;
 
@@ -176,7 +188,8 @@ namespace rv
 		// Count the number of right compressions
 		int32_t rightComprCount = count - leftComprCount;
 
-		// Compress left all elements right of the tip
+		// Compress left all elements right of the tip (vacated slots at the end are not moved again)
+		int32_t tailPos = size;
 		for (int32_t i = leftComprCount - 1; i >= 0; i--)
 		{
 			const int32_t cId = i;
@@ -197,30 +210,17 @@ namespace rv
 			// Actual position of the component without wrapping
 			const int32_t actualPos = tipOffset + comprPos;
 			// Calculate amount of elements to be compressed left
-			const int32_t comprCount = size - actualPos - 1;
+			const int32_t comprCount = tailPos - actualPos - 1;
 			// Perform compression by moving memory blocks
 			const int32_t srcPos = actualPos + 1;
 			const int32_t dstPos = srcPos - comprShifts;
 			memmove(dataPos() + dstPos, dataPos() + srcPos, comprCount * sizeof(EntityProxy));
-
-			// Update entity ids
-			lookupBuffer.reserve(lookupBuffer.size() + comprCount);
-			for (int32_t i = 0; i < comprCount; i++)
-			{
-				EntityProxy& entity = data[baseOffset + dstPos + i];
-				entity.groupPos -= comprShifts;
-
-				// TODO: Check if we can keep track only of entities the user wants to
-				// Pay for what you use
-				// if (entity.IsTracked())
-				{
-					lookupBuffer.push_back({entity.entityId, entity.groupPos});
-				}
-			}
+			tailPos -= comprShifts;
 		}
 		size -= leftComprCount;
 
-		// Compress right all elements left of the tip
+		// Compress right all elements left of the tip (vacated slots at the start are not moved again)
+		int32_t headPos = 0;
 		for (int32_t i = leftComprCount; i < count; i++)
 		{
 			const int32_t cId = i;
@@ -239,24 +239,10 @@ namespace rv
 				i++;	       // Can skip next compression
 			}
 			// Calculate amount of elements to be compressed right
-			const int32_t comprCount = comprPos - rightSize;
+			const int32_t comprCount = comprPos - rightSize - headPos;
 			// Perform compression by moving memory blocks
-			memmove(dataPos() + comprShifts, dataPos(), comprCount * sizeof(EntityProxy));
-
-			// Update entity ids
-			lookupBuffer.reserve(lookupBuffer.size() + comprCount);
-			for (int32_t i = 0; i < comprCount; i++)
-			{
-				EntityProxy& entity = data[baseOffset + comprShifts + i];
-				entity.groupPos -= (comprShifts + leftComprCount);
-
-				// TODO: Check if we can keep track only of entities the user wants to
-				// Pay for what you use
-				// if (entity.IsTracked())
-				{
-					lookupBuffer.push_back({entity.entityId, entity.groupPos});
-				}
-			}
+			memmove(dataPos() + headPos + comprShifts, dataPos() + headPos, comprCount * sizeof(EntityProxy));
+			headPos += comprShifts;
 		}
 		baseOffset += rightComprCount;
 		tipOffset -= rightComprCount;
@@ -265,12 +251,25 @@ namespace rv
 		// Roll counter-clockwise to fill removed spaces
 		rollCounterClockwise(rightComprCount);
 
+		// Update entity ids (every entity after the first removed one has shifted)
+		for (int32_t pos = compPos[0]; pos < size; pos++)
+		{
+			EntityProxy& entity = *getComponent(pos);
+			entity.groupPos = pos;
+			if (entity.IsTracked())
+			{
+				lookupBuffer.push_back({entity.entityId, entity.groupPos});
+			}
+		}
+
 		return leftComprCount;
 	}
 
 	inline EntityProxy* ComponentsGroup<EntityProxy>::getComponent(const int32_t compId)
 	{
-		return dataPos() + (tipOffset + compId) % size;
+		// Both the tip and the id are below the size, so a single wrap is enough (no division)
+		const int32_t pos = tipOffset + compId;
+		return dataPos() + pos - size * (1 - signMask(pos - size));
 	}
 
 	inline EntityProxy* ComponentsGroup<EntityProxy>::getLastComponent() { return getComponent(size - 1); }
@@ -297,7 +296,7 @@ namespace rv
 		memcpy(dst, src, toCopy * sizeof(EntityProxy));	    // Roll data
 		tipOffset += toCopy;				    // Increase tipOffset
 		tipOffset -= signMask(size - tipOffset - 1) * size; // Wrap around
-		baseOffset -= toCopy;				    // Decrease base ptr
+		baseOffset -= dstOffset;			    // Decrease base ptr
 	}
 
 	inline int32_t ComponentsGroup<EntityProxy>::shiftClockwise(int32_t count)
@@ -306,14 +305,17 @@ namespace rv
 		const int32_t mask = signMask(count - tipOffset - 1);
 		const int32_t shiftCount = (tipOffset - count) * mask;
 		const int32_t rollCount = count * mask;
-		memcpy(dataPos() + size, dataPos(), rollCount * sizeof(EntityProxy));	    // Roll data
-		memcpy(dataPos(), dataPos() + rollCount, shiftCount * sizeof(EntityProxy)); // Shift data
+		memcpy(dataPos() + size, dataPos(), rollCount * sizeof(EntityProxy));	     // Roll data
+		memmove(dataPos(), dataPos() + rollCount, shiftCount * sizeof(EntityProxy)); // Shift data
 		size += count; // Increases size to update end of array
 		return count;  // Returns how many slots left before tip
 	}
 
 	inline EntityProxy* ComponentsGroup<EntityProxy>::dataPos() { return data + baseOffset; }
 
+	// Static Definitions
+	inline ComponentsGroup<EntityProxy>::LookupList ComponentsGroup<EntityProxy>::lookupBuffer;
+
 } // namespace rv
 
 #endif
\ No newline at end of file
@@ -1,19 +1,28 @@
 #ifndef ENTITYREGISTRY_HPP
 #define ENTITYREGISTRY_HPP
 
+#include "ArchetypeRegistry.h"
+#include "Assert.h"
 #include "Entity.hpp"
 #include "EntityStorage.hpp"
+#include "IComponentQueue.h"
+#include "IEntityQueue.h"
 #include "TemplateMaskPack.h"
 #include "ravine/ecs/EntityGroup.hpp"
 
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace rv
 {
 	using std::tuple;
+	using std::unordered_map;
 	using std::unordered_set;
 
 	class EntityRegistry
@@ -27,7 +36,52 @@ namespace rv
 		friend class BaseSystem;
 
 		/**
-		 * @brief Map with a list of entities to be destroyed for each of their archetype groups.
+		 * @brief Queue of Entities (of a single archetype) whose creation was deferred.
+		 *
+		 * @tparam TComponents Types of components.
+		 */
+		template <class... TComponents>
+		struct CreateQueue : public IEntityQueue
+		{
+			std::vector<Entity> entities;
+			tuple<std::vector<TComponents>...> comps;
+
+			inline void flush() final;
+		};
+
+		/**
+		 * @brief Queue of components (of a single type) to be added to live Entities.
+		 *
+		 * @tparam TComponent Type of the component.
+		 */
+		template <class TComponent>
+		struct AddQueue : public IComponentQueue
+		{
+			unordered_map<Entity, TComponent> comps;
+
+			/**
+			 * @brief Buffer for the components of the batch being inserted.
+			 */
+			std::vector<TComponent> batch;
+
+			inline void insert(ArchetypeId archetype, const Entity* entities, int32_t count) final;
+			inline void assign() final;
+			inline void clear() final { comps.clear(); }
+		};
+
+		/**
+		 * @brief Entity being moved to another archetype, along with its current group.
+		 */
+		struct EntityMove
+		{
+			ArchetypeId srcArchetype;
+			ArchetypeId dstArchetype;
+			int32_t groupPos;
+			Entity entity;
+		};
+
+		/**
+		 * @brief List of entities to be destroyed for each of their archetype groups (indexed by archetype id).
 		 */
 		static GroupIdList entIdToDestroy;
 
@@ -42,9 +96,81 @@ namespace rv
 		static std::vector<EntityReg> entityRegistry;
 
 		/**
-		 * @brief Vacant positions queue on entity registry.
+		 * @brief First free entry of the entity registry (-1 if none), free entries are linked through their
+		 * group position.
+		 */
+		static int32_t freeSlotHead;
+
+		/**
+		 * @brief Last free entry of the entity registry (-1 if none).
+		 */
+		static int32_t freeSlotTail;
+
+		/**
+		 * @brief Order in which free entries of the entity registry are recycled.
+		 */
+		static SlotReuse slotReuse;
+
+		/**
+		 * @brief List of creation queues with at least one Entity waiting to be created.
+		 */
+		static std::vector<IEntityQueue*> entToCreate;
+
+		/**
+		 * @brief Destination archetype of each Entity with pending component additions/removals.
 		 */
-		static std::queue<Entity> entTableVacancy;
+		static unordered_map<Entity, ArchetypeId> entToMove;
+
+		/**
+		 * @brief Queue of the components to be added of each component type (indexed by type id, nullptr if none).
+		 */
+		static std::vector<IComponentQueue*> compToAdd;
+
+		/**
+		 * @brief Buffer of the Entity moves being flushed (sorted by archetype pair).
+		 */
+		static std::vector<EntityMove> moveBuffer;
+
+		/**
+		 * @brief Buffers of the group positions and handles of the Entity move batch being applied.
+		 */
+		static std::vector<int32_t> moveGroupPos;
+		static std::vector<Entity> moveHandles;
+
+		/**
+		 * @brief Buffer of the Entity handles of the last batch creation (\see{EntityRange}).
+		 */
+		static std::vector<Entity> batchBuffer;
+
+		/**
+		 * @brief Amount of flushes between reorderings of the storages groups (0, the default, disables it).
+		 */
+		static int32_t reorderPeriod;
+
+		/**
+		 * @brief Amount of flushes since the last reordering of the storages groups.
+		 */
+		static int32_t flushCount;
+
+		/**
+		 * @brief Either or not the storages groups are unrolled on every flush.
+		 */
+		static bool lockstepTips;
+
+		/**
+		 * @brief Type id of the next storage to be compacted (\see{compact}).
+		 */
+		static ComponentTypeId compactType;
+
+		/**
+		 * @brief Either or not structural operations left Entity lookups that are not applied to the registry yet.
+		 */
+		static std::atomic<bool> lookupsPending;
+
+		/**
+		 * @brief Serializes the lookups applied on read (\see{readEntityLookups}).
+		 */
+		static std::mutex lookupsMutex;
 
 	  public:
 		/**
@@ -66,6 +192,90 @@ namespace rv
 		template <class... TComponents>
 		inline static Entity createEntity();
 
+		/**
+		 * @brief Creates a batch of Entities with the given initialized Components arrays.
+		 * Each storage receives all of its components in a single insertion operation.
+		 *
+		 * @tparam TComponents Type of the components to store.
+		 * @param count Amount of Entities to create.
+		 * @param comps Arrays of initialized Components (one per type), each with *count* elements.
+		 * @return EntityRange The created Entities (valid until the next batch creation, empty if *count* isn't positive).
+		 */
+		template <class... TComponents>
+		inline static EntityRange createEntities(const int32_t count, const TComponents*... comps);
+
+		/**
+		 * @brief Creates a batch of Entities whose Components are copies of the given values.
+		 *
+		 * @tparam TComponents Type of the components to store.
+		 * @param count Amount of Entities to create.
+		 * @param values Value of each Component type to be copied for every Entity.
+		 * @return EntityRange The created Entities (valid until the next batch creation, empty if *count* isn't positive).
+		 */
+		template <class... TComponents>
+		inline static EntityRange createEntities(const int32_t count, const TComponents&... values);
+
+		/**
+		 * @brief Creates a batch of Entities with default constructed Components.
+		 *
+		 * @tparam TComponents Type of the components to default construct.
+		 * @param count Amount of Entities to create.
+		 * @return EntityRange The created Entities (valid until the next batch creation, empty if *count* isn't positive).
+		 */
+		template <class... TComponents>
+		inline static EntityRange createEntities(const int32_t count);
+
+		/**
+		 * @brief Creates a batch of Entities whose Components are initialized by a generator.
+		 * The generator is called as *generator(id, components...)* for each Entity of the batch,
+		 * with *id* being the position of the Entity in the returned range.
+		 *
+		 * @tparam TComponents Type of the components to store.
+		 * @tparam TGenerator Callable type that initializes the components of a single Entity.
+		 * @param count Amount of Entities to create.
+		 * @param generator Callable that receives the batch id and references to default constructed components.
+		 * @return EntityRange The created Entities (valid until the next batch creation, empty if *count* isn't positive).
+		 */
+		template <class... TComponents, class TGenerator>
+		inline static EntityRange generateEntities(const int32_t count, TGenerator&& generator);
+
+		/**
+		 * @brief Creates a batch of untracked Entities with the given initialized Components arrays.
+		 * Untracked Entities get no handle nor registry entry (their proxies hold *InvalidEntity*), so storage
+		 * operations never produce lookups for them. They are only reachable through systems iteration, and
+		 * removed in bulk by \see{removeUntrackedEntities}.
+		 *
+		 * @tparam TComponents Type of the components to store.
+		 * @param count Amount of Entities to create.
+		 * @param comps Arrays of initialized Components (one per type), each with *count* elements.
+		 */
+		template <class... TComponents>
+		inline static void createUntrackedEntities(const int32_t count, const TComponents*... comps);
+
+		/**
+		 * @brief Removes every untracked Entity with exactly the given components at the end of the application
+		 * frame, as \see{removeEntity} (tracked Entities of the same archetype are kept).
+		 *
+		 * @tparam TComponents Type of the components of the untracked Entities (their archetype).
+		 */
+		template <class... TComponents>
+		inline static void removeUntrackedEntities();
+
+		/**
+		 * @brief Creates an Entity with the given initialized Components at the end of the application frame.
+		 * The Entity handle is reserved right away, but its components are only stored uppon calling of the
+		 * *flushEntityOperations* function (which creates every queued Entity of an archetype in a single batch).
+		 * It can be called during serial system updates, as no storage memory is moved. It is not thread safe
+		 * (the entity registry and creation queues are shared), so it must not be called from parallel work
+		 * items nor from systems updated concurrently by a *SystemsManager*.
+		 *
+		 * @tparam TComponents Type of the components to store.
+		 * @param args Initialized Components to store for this Entity.
+		 * @return Entity An entity that will be bound to the given components.
+		 */
+		template <class... TComponents>
+		inline static Entity createEntityDeferred(TComponents... args);
+
 		/**
 		 * @brief Removes a given entity immediately.
 		 *
@@ -82,152 +292,693 @@ namespace rv
 		inline static void removeEntity(Entity& entity);
 
 		/**
-		 * @brief Sorts remove/create entities lists and calls removal operations on the storages.
+		 * @brief Adds a component to a live Entity at the end of the application frame.
+		 * Uppon calling of the *flushEntityOperations* function, the Entity existing components are moved
+		 * straight to its new archetype group (keeping its Entity handle). All Entities moving between
+		 * the same pair of archetypes are moved in a single batch.
+		 * Adding a component type the Entity already has replaces its value.
+		 *
+		 * @tparam TComponent Type of the component to add.
+		 * @param entity The entity to add the component to (its creation might be deferred, ignored if removed).
+		 * @param comp Initialized component to store for this Entity.
+		 */
+		template <class TComponent>
+		inline static void addComponent(const Entity entity, const TComponent& comp = TComponent());
+
+		/**
+		 * @brief Removes a component from a live Entity at the end of the application frame.
+		 * Happens uppon calling of the *flushEntityOperations* function, as \see{addComponent}.
+		 *
+		 * @tparam TComponent Type of the component to remove.
+		 * @param entity The entity to remove the component from (its creation might be deferred, ignored if
+		 * removed).
+		 */
+		template <class TComponent>
+		inline static void removeComponent(const Entity entity);
+
+		/**
+		 * @brief Returns a component of an Entity in constant time (a few flat loads, no searches), it can be
+		 * called from system updates (on any thread, as long as no structural change happens at the same time).
+		 * The first call after structural changes applies their pending Entity lookups (under a lock), later
+		 * calls don't write to the registry.
+		 * The pointer is only valid until the next structural change (entity or component creation/removal).
+		 * Non-const component types stamp the Entity group as changed (taking a new \see{ChangeTick}, a relaxed
+		 * atomic increment), use a const type for read-only access, e.g. getComponent<const Position>(entity).
+		 *
+		 * @tparam TComponent Type of the component (possibly const-qualified).
+		 * @param entity The entity whose component is requested.
+		 * @return TComponent* The component, or nullptr if the Entity doesn't have it (or isn't created yet, or was
+		 * removed).
+		 */
+		template <class TComponent>
+		inline static TComponent* getComponent(const Entity entity);
+
+		/**
+		 * @brief Sorts remove/create entities lists and calls removal operations on the storages,
+		 * then creates all deferred Entities (one batch per archetype), then moves the Entities whose
+		 * components were added/removed (one batch per archetype pair).
+		 * Every few flushes (\see{setReorderPeriod}) the storages groups are reordered by churn.
 		 *
 		 */
 		inline static void flushEntityOperations();
 
 		inline static void patchEntitiesLookup(const std::vector<EntityLookup>& lookupBuf);
 
+		/**
+		 * @brief Either or not a handle refers to a live Entity (constant time, handles to removed Entities
+		 * are rejected even after their registry entry is recycled).
+		 *
+		 * @param entity The entity handle to check.
+		 */
+		inline static bool isAlive(const Entity entity);
+
+		/**
+		 * @brief Sets the order in which the registry entries of removed Entities are recycled.
+		 *
+		 * @param reuse FIFO (default) or LIFO recycling.
+		 */
+		inline static void setSlotReuse(const SlotReuse reuse) { slotReuse = reuse; }
+
+		/**
+		 * @brief Sets how often the storages reorder their groups, so archetypes with the most insertions and
+		 * removals are moved toward the end of each storage (where they roll the fewest components).
+		 *
+		 * Reordering is disabled by default.
+		 *
+		 * @param flushes Amount of flushes between reorderings (0 to disable).
+		 */
+		inline static void setReorderPeriod(const int32_t flushes) { reorderPeriod = flushes; }
+
+		/**
+		 * @brief Sets the lockstep tips mode, where every flush unrolls the storages groups so each archetype
+		 * has the same (zero) tip offset on all of its storages. Systems then process each group as a single
+		 * contiguous chunk, instead of splitting it where the storages tips differ.
+		 * Immediate operations might roll groups again until the next flush.
+		 *
+		 * @param enabled Either or not groups are unrolled on every flush.
+		 */
+		inline static void setLockstepTips(const bool enabled) { lockstepTips = enabled; }
+
+		/**
+		 * @brief Incrementally compacts the storages, unrolling their groups (restoring single chunk iteration)
+		 * and shrinking the gaps between them down to the slack policy headroom. Stops once the given amount
+		 * of bytes has been moved, the next call resumes where it stopped, so it can be spread over idle
+		 * frame time. Group positions are kept, so it can be called at any point out of system updates.
+		 *
+		 * @param budget Amount of bytes that may be moved (a group is never split, so it might be exceeded).
+		 * @return true If every storage has been compacted, false if the budget ran out before.
+		 */
+		inline static bool compact(size_t budget);
+
+		/**
+		 * @brief Sets the headroom (slack) policy for the groups of the given component storages.
+		 *
+		 * @tparam TComponents Type of the components whose storages will use the policy.
+		 * @param policy Slack policy (fixed and/or proportional to the group size).
+		 */
+		template <class... TComponents>
+		inline static void setSlackPolicy(const SlackPolicy& policy);
+
+		/**
+		 * @brief Sets the capacity release policy for the given component storages, so their memory follows
+		 * the live population (\see{ShrinkPolicy}). The policy is applied at the end of each
+		 * *flushEntityOperations* call (immediate removals included).
+		 *
+		 * @tparam TComponents Type of the components whose storages will use the policy.
+		 * @param policy Shrink policy (threshold and kept headroom).
+		 */
+		template <class... TComponents>
+		inline static void setShrinkPolicy(const ShrinkPolicy& policy);
+
+		/**
+		 * @brief Sets the capacity growth policy for the given component storages (\see{GrowthPolicy}).
+		 *
+		 * @tparam TComponents Type of the components whose storages will use the policy.
+		 * @param policy Growth policy (geometric factor, one to grow to the exact requirement).
+		 */
+		template <class... TComponents>
+		inline static void setGrowthPolicy(const GrowthPolicy& policy);
+
+		/**
+		 * @brief Reserves room for the given amount of Entities with the given Components types, creating their
+		 * archetype groups and growing every involved storage (entity proxies included) in a single step,
+		 * so creating those Entities afterwards doesn't reallocate nor roll any group.
+		 * Room is also reserved on the entity registry, for the Entity handles.
+		 *
+		 * @tparam TComponents Type of the components of the Entities to be created.
+		 * @param count Amount of Entities to reserve room for.
+		 */
+		template <class... TComponents>
+		inline static void reserve(const int32_t count);
+
+		/**
+		 * @brief Packs every storage and releases all of their unused capacity (decommitting the pages of
+		 * paged storages), e.g. after a population drop. Group positions are kept.
+		 */
+		inline static void shrinkToFit();
+
 	  private:
 		template <class... TComponents>
-		constexpr static MaskArray<sizeof...(TComponents)> getMaskArray();
+		inline static MaskArray<sizeof...(TComponents)> getMaskArray();
+
+		template <class... TComponents>
+		inline static ArchetypeId getArchetype();
+
+		template <class... TComponents>
+		inline static QueryId getQuery();
 
 		template <class TComponent>
-		inline static CompGroupIt<TComponent> getComponentIterator(intptr_t mask);
+		inline static CompGroupIt<TComponent> getComponentIterator(const QueryId query);
 
 		template <class... TComponents>
 		inline static tuple<CompGroupIt<TComponents>...> getComponentIterators();
 
-		template <class TComponent, class... TComponents>
-		inline static void createComponent(MaskArray<sizeof...(TComponents)> maskArray,
-						   const TComponent& arg = TComponent());
+		/**
+		 * @brief Gets the iterators of a (filtered) query, one group per matched archetype on every iterator.
+		 */
+		template <class... TComponents>
+		inline static tuple<CompGroupIt<TComponents>...> getComponentIterators(const QueryId query);
+
+		template <class... TComponents>
+		inline static uint64_t getQueryVersion();
+
+		inline static uint32_t getStorageVersion(const ComponentTypeId type);
+
+		template <class TComponent>
+		inline static void createComponent(const ArchetypeId archetype, const TComponent& arg = TComponent());
+
+		template <class... TComponents>
+		inline static void createComponents(const ArchetypeId archetype, const TComponents&... args);
+
+		template <class TComponent>
+		inline static void createComponentBatch(const ArchetypeId archetype, const TComponent* comps,
+							const int32_t count);
+
+		inline static Entity fetchEntity();
+
+		/**
+		 * @brief Frees an entry of the entity registry (invalidating its handles) and links it for recycling,
+		 * unless its generation saturated (the entry is retired).
+		 */
+		inline static void releaseEntity(const Entity entity);
+
+		/**
+		 * @brief Appends new entries to the entity registry, aborting if the handle index space is exhausted.
+		 *
+		 * @return Entity The handle of the first appended entry.
+		 */
+		inline static Entity appendEntries(const int32_t count);
+
+		inline static EntityRange allocateEntities(const int32_t count);
+
+		template <class... TComponents>
+		inline static CreateQueue<TComponents...>& getCreateQueue();
+
+		/**
+		 * @brief Binds reserved Entities to an archetype, storing their proxies.
+		 *
+		 * @return ArchetypeId The archetype whose storage groups must receive the Entities components.
+		 */
+		template <class... TComponents>
+		inline static ArchetypeId bindEntities(const Entity* entities, const int32_t count);
 
 		template <class... TComponents>
-		inline static void createComponents(MaskArray<sizeof...(TComponents)>& maskArray, TComponents... args);
+		inline static void insertEntities(const Entity* entities, const int32_t count,
+						  const TComponents*... comps);
+
+		template <class TComponent>
+		inline static AddQueue<TComponent>& getAddQueue();
+
+		/**
+		 * @brief Returns the pending destination archetype of an Entity (its current archetype if none).
+		 */
+		inline static ArchetypeId& getMoveTarget(const Entity entity);
+
+		/**
+		 * @brief Moves all Entities with pending component additions/removals to their new archetypes.
+		 */
+		inline static void flushEntityMoves();
+
+		/**
+		 * @brief Moves a batch of Entities between the same pair of archetypes.
+		 *
+		 * @param moves Entity moves, sorted by group position.
+		 * @param count Amount of Entity moves.
+		 */
+		inline static void moveEntities(const EntityMove* moves, const int32_t count);
+
+		/**
+		 * @brief Patches the registry group positions with the pending Entity lookups (if any).
+		 * Lookups are accumulated by storage operations and applied lazily: right before a group position is
+		 * read and once at the end of every flush, instead of after every single Entity creation/removal.
+		 */
+		inline static void syncEntityLookups();
+
+		/**
+		 * @brief Flags the Entity lookups left by a structural operation as pending (applied on the next read).
+		 */
+		inline static void deferEntityLookups();
 
-		template <class EntityReg, class... TComponents>
-		inline static void createComponents(MaskArray<sizeof...(TComponents) + 1>& maskArray, EntityReg reg);
+		/**
+		 * @brief Applies the pending Entity lookups before a read that might run concurrently with other reads.
+		 * Without pending lookups it is a single acquire load, otherwise the first reader applies them under a lock.
+		 */
+		inline static void readEntityLookups();
 	};
 
 	// Static Definitions
 	inline GroupIdList EntityRegistry::entIdToDestroy;
 	inline std::unordered_set<IComponentStorage*> EntityRegistry::storagesToDestroy;
 	inline std::vector<EntityReg> EntityRegistry::entityRegistry;
-	inline std::queue<Entity> EntityRegistry::entTableVacancy;
+	inline int32_t EntityRegistry::freeSlotHead = -1;
+	inline int32_t EntityRegistry::freeSlotTail = -1;
+	inline SlotReuse EntityRegistry::slotReuse = SlotReuse::Fifo;
+	inline std::vector<IEntityQueue*> EntityRegistry::entToCreate;
+	inline unordered_map<Entity, ArchetypeId> EntityRegistry::entToMove;
+	inline std::vector<IComponentQueue*> EntityRegistry::compToAdd;
+	inline std::vector<EntityRegistry::EntityMove> EntityRegistry::moveBuffer;
+	inline std::vector<int32_t> EntityRegistry::moveGroupPos;
+	inline std::vector<Entity> EntityRegistry::moveHandles;
+	inline std::vector<Entity> EntityRegistry::batchBuffer;
+	inline int32_t EntityRegistry::reorderPeriod = 0;
+	inline int32_t EntityRegistry::flushCount = 0;
+	inline bool EntityRegistry::lockstepTips = false;
+	inline ComponentTypeId EntityRegistry::compactType = 0;
+	inline std::atomic<bool> EntityRegistry::lookupsPending{false};
+	inline std::mutex EntityRegistry::lookupsMutex;
+
+	template <class... TComponents>
+	inline MaskArray<sizeof...(TComponents)> EntityRegistry::getMaskArray()
+	{
+		return {ComponentTypeRegistry::typeId<TComponents>()...};
+	}
+
+	template <class... TComponents>
+	inline ArchetypeId EntityRegistry::getArchetype()
+	{
+		// Interned once per type list, along with the storages of its types
+		static const ArchetypeId archetype = []() {
+			using expander = int[];
+			expander{0, ((void)(ComponentTypeRegistry::setStorage(
+					       ComponentTypeRegistry::typeId<TComponents>(), ComponentStorage<TComponents>::getInstance())),
+				     0)...};
+			return ArchetypeRegistry::getArchetype(getMaskArray<TComponents...>().data(), sizeof...(TComponents));
+		}();
+		return archetype;
+	}
 
 	template <class... TComponents>
-	constexpr MaskArray<sizeof...(TComponents)> EntityRegistry::getMaskArray()
+	inline QueryId EntityRegistry::getQuery()
 	{
-		return {reinterpret_cast<intptr_t>(ComponentStorage<TComponents>::getInstance())...};
+		// Interned once per type list
+		static const QueryId query =
+		    ArchetypeRegistry::getQuery(getMaskArray<TComponents...>().data(), sizeof...(TComponents));
+		return query;
 	}
 
 	template <class TComponent>
-	inline CompGroupIt<TComponent> EntityRegistry::getComponentIterator(intptr_t mask)
+	inline CompGroupIt<TComponent> EntityRegistry::getComponentIterator(const QueryId query)
 	{
 		ComponentStorage<TComponent>* storage = ComponentStorage<TComponent>::getInstance();
-		return storage->getComponentIterator(mask);
+		return storage->getComponentIterator(query);
 	}
 
 	template <class... TComponents>
 	inline tuple<CompGroupIt<TComponents>...> EntityRegistry::getComponentIterators()
 	{
-		intptr_t mask = MaskPack<TComponents...>::mask();
-		return {getComponentIterator<TComponents>(mask)...};
+		return getComponentIterators<TComponents...>(getQuery<TComponents...>());
+	}
+
+	template <class... TComponents>
+	inline tuple<CompGroupIt<TComponents>...> EntityRegistry::getComponentIterators(const QueryId query)
+	{
+		return {getComponentIterator<TComponents>(query)...};
+	}
+
+	template <class... TComponents>
+	inline uint64_t EntityRegistry::getQueryVersion()
+	{
+		// Storage versions only increase, so their sum changes whenever any of them does
+		return (uint64_t(0) + ... + getStorageVersion(ComponentTypeRegistry::typeId<TComponents>()));
+	}
+
+	inline uint32_t EntityRegistry::getStorageVersion(const ComponentTypeId type)
+	{
+		// Storages are only registered along with their first archetype
+		IComponentStorage* storage = ComponentTypeRegistry::getStorage(type);
+		return (storage != nullptr) ? storage->getVersion() : 0;
 	}
 
-	template <class TComponent, class... TComponents>
-	inline void EntityRegistry::createComponent(MaskArray<sizeof...(TComponents)> maskArray, const TComponent& arg)
+	template <class TComponent>
+	inline void EntityRegistry::createComponent(const ArchetypeId archetype, const TComponent& arg)
 	{
 		ComponentStorage<TComponent>* storage = ComponentStorage<TComponent>::getInstance();
-		storage->addComponent(maskArray.data(), sizeof...(TComponents), arg);
+		storage->addComponent(archetype, arg);
 	}
 
 	template <class... TComponents>
-	inline void EntityRegistry::createComponents(MaskArray<sizeof...(TComponents)>& masks, TComponents... args)
+	inline void EntityRegistry::createComponents(const ArchetypeId archetype, const TComponents&... args)
 	{
 		using expander = int[];
-		expander{0, ((void)(createComponent<TComponents, TComponents...>(masks, args)), 0)...};
+		expander{0, ((void)(createComponent<TComponents>(archetype, args)), 0)...};
 	}
 
-	template <class EntityReg, class... TComponents>
-	inline void EntityRegistry::createComponents(MaskArray<sizeof...(TComponents) + 1>& masks, EntityReg reg)
+	template <class TComponent>
+	inline void EntityRegistry::createComponentBatch(const ArchetypeId archetype, const TComponent* comps,
+							 const int32_t count)
 	{
-		using expander = int[];
-		createComponent<EntityReg, EntityProxy, TComponents...>(masks, reg);
-		expander{0, ((void)(createComponent<TComponents, EntityProxy, TComponents...>(masks)), 0)...};
+		ComponentStorage<TComponent>* storage = ComponentStorage<TComponent>::getInstance();
+		storage->addComponent(archetype, comps, count);
 	}
 
-	template <class... TComponents>
-	inline Entity EntityRegistry::createEntity(TComponents... args)
+	inline Entity EntityRegistry::fetchEntity()
 	{
 		// Fetch Registry Entry
-		Entity entity;
-		EntityReg* reg;
-		if (entTableVacancy.size() > 0)
-		{
-			entity = entTableVacancy.front();
-			entTableVacancy.pop();
-			reg = &entityRegistry[entity];
-			delete reg->compTypes;
-		}
-		else
+		if (freeSlotHead >= 0)
 		{
-			entity = entityRegistry.size();
-			entityRegistry.push_back(EntityReg());
-			reg = &entityRegistry[entity];
+			const int32_t index = freeSlotHead;
+			EntityReg* reg = &entityRegistry[index];
+			freeSlotHead = reg->groupPos;
+			if (freeSlotHead < 0)
+			{
+				freeSlotTail = -1;
+			}
+			reg->groupPos = -1;
+			return makeEntity(index, reg->generation);
 		}
 
-		// Override Entity Registry
-		reg->entityId = entity;
-		reg->groupPos = -1;
-		reg->compTypes = new intptr_t[sizeof...(TComponents) + 1];
-		reg->typesCount = sizeof...(TComponents) + 1;
-		MaskArray<sizeof...(TComponents) + 1> masks = getMaskArray<EntityProxy, TComponents...>();
-		memcpy(reg->compTypes, masks.data(), (sizeof...(TComponents) + 1) * sizeof(intptr_t));
-		EntityProxy proxy = {entity, -1};
-		createComponents<EntityProxy, TComponents...>(masks, proxy, args...);
-
-		// Flush the Entity Proxy storage so we can get updated group positions
-		ComponentStorage<EntityProxy>* storage = ComponentStorage<EntityProxy>::getInstance();
-		storage->flushEntityLookups(&EntityRegistry::patchEntitiesLookup);
-
-		return entity;
+		return appendEntries(1);
 	}
 
-	template <class... TComponents>
-	inline Entity EntityRegistry::createEntity()
+	inline Entity EntityRegistry::appendEntries(const int32_t count)
 	{
-		// Fetch Registry Entry
-		Entity entity;
-		EntityReg* reg;
-		if (entTableVacancy.size() > 0)
-		{
-			entity = entTableVacancy.front();
-			entTableVacancy.pop();
-			reg = &entityRegistry[entity];
-			delete reg->compTypes;
-		}
-		else
+		// Registry entries are addressed (and linked on the free list) by int32 positions
+		const size_t first = entityRegistry.size();
+		if (first + count > MaxEntityCount)
 		{
-			entity = entityRegistry.size();
-			entityRegistry.push_back(EntityReg());
-			reg = &entityRegistry[entity];
+			fprintf(stderr, "EntityRegistry: out of Entity handles (%u max)\n", MaxEntityCount);
+			abort();
+		}
+		entityRegistry.resize(first + count);
+		return static_cast<Entity>(first);
+	}
+
+	inline void EntityRegistry::releaseEntity(const Entity entity)
+	{
+		const int32_t index = static_cast<int32_t>(entityIndex(entity));
+		EntityReg* reg = &entityRegistry[index];
+		reg->archetype = InvalidArchetype;
+		reg->generation++;
+		reg->groupPos = -1;
+
+		// Retire the entry once its generation saturates, so stale handles are never matched again
+		if (reg->generation == RetiredGeneration)
+		{
+			return;
+		}
+
+		// Link the entry on the free list
+		if (freeSlotHead < 0)
+		{
+			freeSlotHead = index;
+			freeSlotTail = index;
+		}
+		else if (slotReuse == SlotReuse::Lifo)
+		{
+			reg->groupPos = freeSlotHead;
+			freeSlotHead = index;
+		}
+		else
+		{
+			entityRegistry[freeSlotTail].groupPos = index;
+			freeSlotTail = index;
+		}
+	}
+
+	inline bool EntityRegistry::isAlive(const Entity entity)
+	{
+		const uint32_t index = entityIndex(entity);
+		return index < entityRegistry.size() && entityRegistry[index].generation == entityGeneration(entity);
+	}
+
+	inline EntityRange EntityRegistry::allocateEntities(const int32_t count)
+	{
+		// Recycle freed entries first, then append the remaining ones
+		batchBuffer.resize(count);
+		int32_t id = 0;
+		for (; id < count && freeSlotHead >= 0; id++)
+		{
+			batchBuffer[id] = fetchEntity();
+		}
+		if (id < count)
+		{
+			const Entity first = appendEntries(count - id);
+			for (int32_t i = 0; id < count; id++, i++)
+			{
+				batchBuffer[id] = first + i;
+			}
+		}
+		return {batchBuffer.data(), count};
+	}
+
+	template <class... TComponents>
+	inline ArchetypeId EntityRegistry::bindEntities(const Entity* entities, const int32_t count)
+	{
+		// Override Entity Registries and build their proxies
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
+		std::vector<EntityProxy> proxies(count);
+		for (int32_t i = 0; i < count; i++)
+		{
+			const Entity entity = entities[i];
+			EntityReg* reg = &entityRegistry[entityIndex(entity)];
+			reg->groupPos = -1;
+			reg->archetype = archetype;
+			proxies[i] = {entity, -1};
+		}
+		createComponentBatch<EntityProxy>(archetype, proxies.data(), count);
+		return archetype;
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::insertEntities(const Entity* entities, const int32_t count,
+						   const TComponents*... comps)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		// A single insertion per storage (one roll per group)
+		const ArchetypeId archetype = bindEntities<TComponents...>(entities, count);
+		using expander = int[];
+		expander{0, ((void)(createComponentBatch<TComponents>(archetype, comps, count)), 0)...};
+	}
+
+	template <class... TComponents>
+	inline EntityRange EntityRegistry::createEntities(const int32_t count, const TComponents*... comps)
+	{
+		if (count <= 0)
+		{
+			return {};
+		}
+
+		EntityRange range = allocateEntities(count);
+		insertEntities<TComponents...>(range.entities, count, comps...);
+		deferEntityLookups();
+		return range;
+	}
+
+	template <class... TComponents>
+	inline EntityRange EntityRegistry::createEntities(const int32_t count, const TComponents&... values)
+	{
+		if (count <= 0)
+		{
+			return {};
+		}
+
+		// Each storage group is filled in place with copies of the values (a single insertion per storage)
+		EntityRange range = allocateEntities(count);
+		const ArchetypeId archetype = bindEntities<TComponents...>(range.entities, count);
+		using expander = int[];
+		expander{0,
+			 ((void)(ComponentStorage<TComponents>::getInstance()->fillComponent(archetype, values, count)), 0)...};
+		deferEntityLookups();
+		return range;
+	}
+
+	template <class... TComponents>
+	inline EntityRange EntityRegistry::createEntities(const int32_t count)
+	{
+		return createEntities<TComponents...>(count, TComponents()...);
+	}
+
+	template <class... TComponents, class TGenerator>
+	inline EntityRange EntityRegistry::generateEntities(const int32_t count, TGenerator&& generator)
+	{
+		if (count <= 0)
+		{
+			return {};
 		}
 
+		// Groups are filled with default constructed components, which are then generated in place
+		EntityRange range = allocateEntities(count);
+		const ArchetypeId archetype = bindEntities<TComponents...>(range.entities, count);
+		tuple<ComponentsGroup<TComponents>*...> groups{
+		    ComponentStorage<TComponents>::getInstance()->fillComponent(archetype, TComponents(), count)...};
+
+		// The new components are the last ones of their groups (at the same group positions on every storage)
+		const int32_t first = std::get<0>(groups)->size - count;
+		for (int32_t i = 0; i < count; i++)
+		{
+			generator(i, *std::get<ComponentsGroup<TComponents>*>(groups)->getComponent(first + i)...);
+		}
+		deferEntityLookups();
+		return range;
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::createUntrackedEntities(const int32_t count, const TComponents*... comps)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
+		const std::vector<EntityProxy> proxies(count, EntityProxy{InvalidEntity, -1});
+		using expander = int[];
+		createComponentBatch<EntityProxy>(archetype, proxies.data(), count);
+		expander{0, ((void)(createComponentBatch<TComponents>(archetype, comps, count)), 0)...};
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::removeUntrackedEntities()
+	{
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
+		ComponentStorage<EntityProxy>* proxyStorage = ComponentStorage<EntityProxy>::getInstance();
+		const GroupIt<EntityProxy> groupIt = proxyStorage->findGroup(archetype);
+		if (groupIt == proxyStorage->groups.end())
+		{
+			return;
+		}
+
+		// Untracked Entities are only known by their proxies (holding InvalidEntity)
+		if (archetype >= static_cast<ArchetypeId>(entIdToDestroy.size()))
+		{
+			entIdToDestroy.resize(archetype + 1);
+		}
+		std::vector<int32_t>& idsList = entIdToDestroy[archetype];
+		const size_t listSize = idsList.size();
+		ComponentsGroup<EntityProxy>* group = *groupIt;
+		for (int32_t i = 0; i < group->size; i++)
+		{
+			if (group->getComponent(i)->entityId == InvalidEntity)
+			{
+				idsList.push_back(i);
+			}
+		}
+		if (idsList.size() == listSize)
+		{
+			return;
+		}
+
+		// Mark all the archetype storages for cleanup
+		for (const ComponentTypeId type : ArchetypeRegistry::getTypes(archetype))
+		{
+			storagesToDestroy.insert(ComponentTypeRegistry::getStorage(type));
+		}
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::CreateQueue<TComponents...>::flush()
+	{
+		// Drop the Entities removed before being created (their handles are stale)
+		using expander = int[];
+		int32_t count = 0;
+		for (int32_t i = 0; i < static_cast<int32_t>(entities.size()); i++)
+		{
+			if (!isAlive(entities[i]))
+			{
+				continue;
+			}
+			if (count != i)
+			{
+				entities[count] = entities[i];
+				expander{0, ((void)(std::get<std::vector<TComponents>>(comps)[count] =
+							std::move(std::get<std::vector<TComponents>>(comps)[i])),
+					     0)...};
+			}
+			count++;
+		}
+		insertEntities<TComponents...>(entities.data(), count, std::get<std::vector<TComponents>>(comps).data()...);
+
+		// Cleanup for next frame
+		entities.clear();
+		expander{0, ((void)(std::get<std::vector<TComponents>>(comps).clear()), 0)...};
+	}
+
+	template <class... TComponents>
+	inline EntityRegistry::CreateQueue<TComponents...>& EntityRegistry::getCreateQueue()
+	{
+		static CreateQueue<TComponents...> queue;
+		return queue;
+	}
+
+	template <class... TComponents>
+	inline Entity EntityRegistry::createEntityDeferred(TComponents... args)
+	{
+		// Reserve Registry Entry (bound to the components on flush), its archetype is set right away so component
+		// additions/removals can be queued before the flush, and it has no group position until then
+		Entity entity = fetchEntity();
+		EntityReg* reg = &entityRegistry[entityIndex(entity)];
+		reg->groupPos = -1;
+		reg->archetype = getArchetype<EntityProxy, TComponents...>();
+
+		// Enqueue components on the archetype creation queue
+		CreateQueue<TComponents...>& queue = getCreateQueue<TComponents...>();
+		if (queue.entities.empty())
+		{
+			entToCreate.push_back(&queue);
+		}
+		queue.entities.push_back(entity);
+		using expander = int[];
+		expander{0, ((void)(std::get<std::vector<TComponents>>(queue.comps).push_back(args)), 0)...};
+
+		return entity;
+	}
+
+	template <class... TComponents>
+	inline Entity EntityRegistry::createEntity(TComponents... args)
+	{
+		// Fetch Registry Entry
+		Entity entity = fetchEntity();
+		EntityReg* reg = &entityRegistry[entityIndex(entity)];
+
 		// Override Entity Registry
-		reg->entityId = entity;
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
 		reg->groupPos = -1;
-		reg->compTypes = new intptr_t[sizeof...(TComponents) + 1];
-		reg->typesCount = sizeof...(TComponents) + 1;
-		MaskArray<sizeof...(TComponents) + 1> masks = getMaskArray<EntityProxy, TComponents...>();
-		memcpy(reg->compTypes, masks.data(), (sizeof...(TComponents) + 1) * sizeof(intptr_t));
+		reg->archetype = archetype;
 		EntityProxy proxy = {entity, -1};
-		createComponents<EntityProxy, TComponents...>(masks, proxy);
+		createComponents<EntityProxy, TComponents...>(archetype, proxy, args...);
+		deferEntityLookups();
 
-		// Flush the Entity Proxy storage so we can get updated group positions
-		ComponentStorage<EntityProxy>* storage = ComponentStorage<EntityProxy>::getInstance();
-		storage->flushEntityLookups(&EntityRegistry::patchEntitiesLookup);
+		return entity;
+	}
+
+	template <class... TComponents>
+	inline Entity EntityRegistry::createEntity()
+	{
+		// Fetch Registry Entry
+		Entity entity = fetchEntity();
+		EntityReg* reg = &entityRegistry[entityIndex(entity)];
+
+		// Override Entity Registry
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
+		reg->groupPos = -1;
+		reg->archetype = archetype;
+		EntityProxy proxy = {entity, -1};
+		createComponents<EntityProxy, TComponents...>(archetype, proxy, TComponents()...);
+		deferEntityLookups();
 
 		return entity;
 	}
@@ -235,76 +986,89 @@ namespace rv
 	inline void EntityRegistry::removeEntityImediatelly(Entity& entity)
 	{
 		_ASSERT(entity != InvalidEntity);
+		if (!isAlive(entity))
+		{
+			// Stale handle, the entity was already removed
+			entity = InvalidEntity;
+			return;
+		}
 
-		// Fetch Registry Entry
-		EntityReg* reg = &entityRegistry[entity];
+		// Fetch Registry Entry (with an up to date group position)
+		syncEntityLookups();
+		EntityReg* reg = &entityRegistry[entityIndex(entity)];
 
-		// Remove components from storages
-		GroupMask typeMask(reg->compTypes, reg->typesCount);
-		for (int32_t i = 0; i < reg->typesCount; i++)
+		// Drop pending component additions/removals
+		entToMove.erase(entity);
+
+		// Entities not created yet are only dropped from their creation queue (it skips stale handles)
+		if (reg->groupPos < 0)
 		{
-			IComponentStorage* storage = reinterpret_cast<IComponentStorage*>(reg->compTypes[i]);
-			storage->removeComponent(reg->groupPos, typeMask);
+			releaseEntity(entity);
+			entity = InvalidEntity;
+			return;
 		}
 
-		// Flush the Entity Proxy storage so we can get updated group positions
-		ComponentStorage<EntityProxy>* storage = ComponentStorage<EntityProxy>::getInstance();
-		storage->flushEntityLookups(&EntityRegistry::patchEntitiesLookup);
-
-		// Open up an entity registry slot
-		entTableVacancy.push(entity);
+		// Remove components from storages
+		for (const ComponentTypeId type : ArchetypeRegistry::getTypes(reg->archetype))
+		{
+			IComponentStorage* storage = ComponentTypeRegistry::getStorage(type);
+			storage->removeComponent(reg->groupPos, reg->archetype);
+		}
 
-		// Set as invalid
-		reg->entityId = InvalidEntity;
-		reg->groupPos = -1;
+		// Open up an entity registry slot (set as invalid)
+		releaseEntity(entity);
 		entity = InvalidEntity;
+		deferEntityLookups();
 	}
 
 	inline void EntityRegistry::removeEntity(Entity& entity)
 	{
 		_ASSERT(entity != InvalidEntity);
-		EntityReg entityReg = entityRegistry[entity];
-		GroupMask typeMask(entityReg.compTypes, entityReg.typesCount);
-
-		// Mark all this entity storages for cleanup
-		for (int32_t i = 0; i < entityReg.typesCount; i++)
+		if (!isAlive(entity))
 		{
-			storagesToDestroy.insert((IComponentStorage*)entityReg.compTypes[i]);
+			// Stale handle, the entity was already removed
+			entity = InvalidEntity;
+			return;
 		}
+		syncEntityLookups();
+		const EntityReg& entityReg = entityRegistry[entityIndex(entity)];
 
-		// Get existing group list or create new one
-		std::vector<int32_t>* groupPosToRmv;
-		GroupIdList::iterator it = entIdToDestroy.lower_bound(typeMask);
-		if (it != entIdToDestroy.end() && !(entIdToDestroy.key_comp()(typeMask, it->first)))
+		// Drop pending component additions/removals
+		entToMove.erase(entity);
+
+		// Entities not created yet are only dropped from their creation queue (it skips stale handles)
+		if (entityReg.groupPos < 0)
 		{
-			groupPosToRmv = it->second;
+			releaseEntity(entity);
+			entity = InvalidEntity;
+			return;
 		}
-		else
+
+		// Mark all this entity storages for cleanup
+		for (const ComponentTypeId type : ArchetypeRegistry::getTypes(entityReg.archetype))
 		{
-			groupPosToRmv = new std::vector<int32_t>();
-			entIdToDestroy.insert(it, GroupIdPair(typeMask, groupPosToRmv));
+			storagesToDestroy.insert(ComponentTypeRegistry::getStorage(type));
 		}
 
-		// Add entity group id to remove group
-		groupPosToRmv->push_back(entityReg.groupPos);
-
-		// Open up an entity registry slot
-		entTableVacancy.push(entity);
+		// Add entity group id to its archetype remove list
+		if (entityReg.archetype >= static_cast<ArchetypeId>(entIdToDestroy.size()))
+		{
+			entIdToDestroy.resize(entityReg.archetype + 1);
+		}
+		entIdToDestroy[entityReg.archetype].push_back(entityReg.groupPos);
 
-		// Set as invalid
-		entityReg.entityId = InvalidEntity;
-		entityReg.groupPos = -1;
+		// Open up an entity registry slot (set as invalid)
+		releaseEntity(entity);
 		entity = InvalidEntity;
 	}
 
 	inline void EntityRegistry::flushEntityOperations()
 	{
 		// Sorts and make unique entities to destroy on all groups
-		for (GroupIdList::iterator it = entIdToDestroy.begin(); it != entIdToDestroy.end(); it++)
+		for (std::vector<int32_t>& idsList : entIdToDestroy)
 		{
-			std::vector<int32_t>* idsList = it->second;
-			std::sort(idsList->begin(), idsList->end());
-			idsList->erase(std::unique(idsList->begin(), idsList->end()), idsList->end());
+			std::sort(idsList.begin(), idsList.end());
+			idsList.erase(std::unique(idsList.begin(), idsList.end()), idsList.end());
 		}
 
 		// Calls removal of the entities for all related storages
@@ -313,23 +1077,351 @@ namespace rv
 			storage->removeComponents(entIdToDestroy);
 		}
 
-		// Flush the Entity Proxy storage so we can get updated group positions
+		// Cleanup for next frame (lists keep their capacity)
+		for (std::vector<int32_t>& idsList : entIdToDestroy)
+		{
+			idsList.clear();
+		}
+		storagesToDestroy.clear();
+
+		// Flush late create list (a single batch insertion per archetype)
+		for (IEntityQueue* queue : entToCreate)
+		{
+			queue->flush();
+		}
+		entToCreate.clear();
+
+		// Move Entities whose components were added/removed, created ones included (group positions are
+		// patched before each batch)
+		flushEntityMoves();
+
+		// Patch the group positions of every Entity created/moved on this flush in a single pass
+		syncEntityLookups();
+
+		// Periodically move high churn groups toward the end of their storages,
+		// and unroll every group on the lockstep tips mode
+		const bool reorder = reorderPeriod > 0 && ++flushCount >= reorderPeriod;
+		if (reorder)
+		{
+			flushCount = 0;
+		}
+		for (ComponentTypeId type = 0; type < ComponentTypeRegistry::getTypeCount(); type++)
+		{
+			IComponentStorage* storage = ComponentTypeRegistry::getStorage(type);
+			if (storage == nullptr)
+			{
+				continue;
+			}
+
+			// Capacity is released once per storage, after all of this flush (and the immediate) removals
+			storage->applyShrinkPolicy();
+			if (reorder)
+			{
+				storage->reorderGroups();
+			}
+			if (lockstepTips)
+			{
+				storage->unrollGroups();
+			}
+		}
+	}
+
+	template <class TComponent>
+	inline TComponent* EntityRegistry::getComponent(const Entity entity)
+	{
+		if (!isAlive(entity))
+		{
+			return nullptr;
+		}
+		// Entities not created yet (deferred creation) have no group position
+		readEntityLookups();
+		const EntityReg& reg = entityRegistry[entityIndex(entity)];
+		if (reg.groupPos < 0)
+		{
+			return nullptr;
+		}
+		ComponentStorage<std::remove_const_t<TComponent>>* storage =
+		    ComponentStorage<std::remove_const_t<TComponent>>::getInstance();
+		return storage->getComponent(reg.archetype, reg.groupPos, !std::is_const<TComponent>::value);
+	}
+
+	template <class TComponent>
+	inline void EntityRegistry::AddQueue<TComponent>::insert(ArchetypeId archetype, const Entity* entities,
+								 int32_t count)
+	{
+		batch.clear();
+		batch.reserve(count);
+		for (int32_t i = 0; i < count; i++)
+		{
+			typename unordered_map<Entity, TComponent>::iterator it = comps.find(entities[i]);
+			_ASSERT(it != comps.end());
+			batch.push_back(std::move(it->second));
+			comps.erase(it);
+		}
+		ComponentStorage<TComponent>::getInstance()->addMovedComponents(archetype, batch.data(), count);
+		batch.clear();
+	}
+
+	template <class TComponent>
+	inline void EntityRegistry::AddQueue<TComponent>::assign()
+	{
+		const ComponentTypeId type = ComponentTypeRegistry::typeId<TComponent>();
+		ComponentStorage<TComponent>* storage = ComponentStorage<TComponent>::getInstance();
+		for (std::pair<const Entity, TComponent>& comp : comps)
+		{
+			// Skip removed entities and components removed after being added
+			const EntityReg& reg = entityRegistry[entityIndex(comp.first)];
+			if (entToMove.count(comp.first) == 0 || !ArchetypeRegistry::hasType(reg.archetype, type))
+			{
+				continue;
+			}
+			*storage->getComponent(reg.archetype, reg.groupPos, true) = std::move(comp.second);
+		}
+	}
+
+	template <class TComponent>
+	inline EntityRegistry::AddQueue<TComponent>& EntityRegistry::getAddQueue()
+	{
+		static AddQueue<TComponent> queue;
+		return queue;
+	}
+
+	inline ArchetypeId& EntityRegistry::getMoveTarget(const Entity entity)
+	{
+		const EntityReg& reg = entityRegistry[entityIndex(entity)];
+		_ASSERT(reg.archetype != InvalidArchetype);
+		return entToMove.try_emplace(entity, reg.archetype).first->second;
+	}
+
+	template <class TComponent>
+	inline void EntityRegistry::addComponent(const Entity entity, const TComponent& comp)
+	{
+		if (!isAlive(entity))
+		{
+			return;
+		}
+
+		// New archetypes might hold this type, so its storage must be known
+		const ComponentTypeId type = ComponentTypeRegistry::typeId<TComponent>();
+		ComponentTypeRegistry::setStorage(type, ComponentStorage<TComponent>::getInstance());
+		if (type >= static_cast<ComponentTypeId>(compToAdd.size()))
+		{
+			compToAdd.resize(type + 1, nullptr);
+		}
+		compToAdd[type] = &getAddQueue<TComponent>();
+
+		ArchetypeId& target = getMoveTarget(entity);
+		target = ArchetypeRegistry::getArchetypeWith(target, type);
+		getAddQueue<TComponent>().comps[entity] = comp;
+	}
+
+	template <class TComponent>
+	inline void EntityRegistry::removeComponent(const Entity entity)
+	{
+		static_assert(!std::is_same<TComponent, EntityProxy>::value, "Entity proxies can't be removed");
+		if (!isAlive(entity))
+		{
+			return;
+		}
+		ArchetypeId& target = getMoveTarget(entity);
+		target = ArchetypeRegistry::getArchetypeWithout(target, ComponentTypeRegistry::typeId<TComponent>());
+	}
+
+	inline void EntityRegistry::flushEntityMoves()
+	{
+		if (entToMove.empty())
+		{
+			return;
+		}
+
+		// Group moves by archetype pair (entities added and removed the same types stay put)
+		moveBuffer.clear();
+		for (const std::pair<const Entity, ArchetypeId>& move : entToMove)
+		{
+			const EntityReg& reg = entityRegistry[entityIndex(move.first)];
+			if (reg.archetype != move.second)
+			{
+				moveBuffer.push_back({reg.archetype, move.second, -1, move.first});
+			}
+		}
+		std::sort(moveBuffer.begin(), moveBuffer.end(), [](const EntityMove& a, const EntityMove& b) {
+			return (a.srcArchetype != b.srcArchetype) ? a.srcArchetype < b.srcArchetype
+								  : a.dstArchetype < b.dstArchetype;
+		});
+
+		for (size_t begin = 0; begin < moveBuffer.size();)
+		{
+			size_t end = begin + 1;
+			while (end < moveBuffer.size() && moveBuffer[end].srcArchetype == moveBuffer[begin].srcArchetype &&
+			       moveBuffer[end].dstArchetype == moveBuffer[begin].dstArchetype)
+			{
+				end++;
+			}
+
+			// Group positions are read per batch, as previous batches compress the source groups
+			syncEntityLookups();
+			for (size_t i = begin; i < end; i++)
+			{
+				moveBuffer[i].groupPos = entityRegistry[entityIndex(moveBuffer[i].entity)].groupPos;
+			}
+			std::sort(moveBuffer.begin() + begin, moveBuffer.begin() + end,
+				  [](const EntityMove& a, const EntityMove& b) { return a.groupPos < b.groupPos; });
+			moveEntities(moveBuffer.data() + begin, end - begin);
+			begin = end;
+		}
+
+		// Replace the values of components added to entities that already had them
+		syncEntityLookups();
+		for (IComponentQueue* queue : compToAdd)
+		{
+			if (queue != nullptr)
+			{
+				queue->assign();
+				queue->clear();
+			}
+		}
+
+		// Cleanup for next frame
+		entToMove.clear();
+	}
+
+	inline void EntityRegistry::moveEntities(const EntityMove* moves, const int32_t count)
+	{
+		const ArchetypeId srcArchetype = moves[0].srcArchetype;
+		const ArchetypeId dstArchetype = moves[0].dstArchetype;
+		moveGroupPos.resize(count);
+		moveHandles.resize(count);
+		for (int32_t i = 0; i < count; i++)
+		{
+			moveGroupPos[i] = moves[i].groupPos;
+			moveHandles[i] = moves[i].entity;
+		}
+
+		// Kept types are moved straight to the destination group, dropped types are removed
+		const std::vector<ComponentTypeId>& dstTypes = ArchetypeRegistry::getTypes(dstArchetype);
+		for (const ComponentTypeId type : ArchetypeRegistry::getTypes(srcArchetype))
+		{
+			IComponentStorage* storage = ComponentTypeRegistry::getStorage(type);
+			if (std::binary_search(dstTypes.begin(), dstTypes.end(), type))
+			{
+				storage->moveComponents(moveGroupPos.data(), count, srcArchetype, dstArchetype);
+			}
+			else
+			{
+				storage->removeComponents(moveGroupPos.data(), count, srcArchetype);
+			}
+		}
+
+		// Added types are inserted in the same (group position) order
+		for (const ComponentTypeId type : dstTypes)
+		{
+			if (!ArchetypeRegistry::hasType(srcArchetype, type))
+			{
+				compToAdd[type]->insert(dstArchetype, moveHandles.data(), count);
+			}
+		}
+
+		for (int32_t i = 0; i < count; i++)
+		{
+			entityRegistry[entityIndex(moveHandles[i])].archetype = dstArchetype;
+		}
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::setSlackPolicy(const SlackPolicy& policy)
+	{
+		using expander = int[];
+		expander{0, ((void)(ComponentStorage<TComponents>::getInstance()->setSlackPolicy(policy)), 0)...};
+	}
+
+	inline bool EntityRegistry::compact(size_t budget)
+	{
+		// Resumes on the storage the last call stopped at, going over every storage once
+		const ComponentTypeId typeCount = ComponentTypeRegistry::getTypeCount();
+		for (ComponentTypeId visited = 0; visited < typeCount; visited++)
+		{
+			if (compactType >= typeCount)
+			{
+				compactType = 0;
+			}
+			IComponentStorage* storage = ComponentTypeRegistry::getStorage(compactType);
+			if (storage != nullptr && !storage->compact(budget))
+			{
+				return false;
+			}
+			compactType++;
+		}
+		return true;
+	}
+
+	inline void EntityRegistry::syncEntityLookups()
+	{
 		ComponentStorage<EntityProxy>* storage = ComponentStorage<EntityProxy>::getInstance();
 		storage->flushEntityLookups(&EntityRegistry::patchEntitiesLookup);
+		lookupsPending.store(false, std::memory_order_release);
+	}
 
-		// Cleanup for next frame
-		entIdToDestroy.clear();
-		storagesToDestroy.clear();
+	inline void EntityRegistry::deferEntityLookups() { lookupsPending.store(true, std::memory_order_relaxed); }
 
-		// TODO Flush late create list
+	inline void EntityRegistry::readEntityLookups()
+	{
+		if (!lookupsPending.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(lookupsMutex);
+		if (lookupsPending.load(std::memory_order_relaxed))
+		{
+			syncEntityLookups();
+		}
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::setShrinkPolicy(const ShrinkPolicy& policy)
+	{
+		using expander = int[];
+		expander{0, ((void)(ComponentStorage<TComponents>::getInstance()->setShrinkPolicy(policy)), 0)...};
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::setGrowthPolicy(const GrowthPolicy& policy)
+	{
+		using expander = int[];
+		expander{0, ((void)(ComponentStorage<TComponents>::getInstance()->setGrowthPolicy(policy)), 0)...};
+	}
+
+	template <class... TComponents>
+	inline void EntityRegistry::reserve(const int32_t count)
+	{
+		const ArchetypeId archetype = getArchetype<EntityProxy, TComponents...>();
+		ComponentStorage<EntityProxy>::getInstance()->reserve(archetype, count);
+		using expander = int[];
+		expander{0, ((void)(ComponentStorage<TComponents>::getInstance()->reserve(archetype, count)), 0)...};
+		entityRegistry.reserve(entityRegistry.size() + count);
+	}
+
+	inline void EntityRegistry::shrinkToFit()
+	{
+		for (ComponentTypeId type = 0; type < ComponentTypeRegistry::getTypeCount(); type++)
+		{
+			IComponentStorage* storage = ComponentTypeRegistry::getStorage(type);
+			if (storage != nullptr)
+			{
+				storage->shrinkToFit();
+			}
+		}
 	}
 
 	inline void EntityRegistry::patchEntitiesLookup(const std::vector<EntityLookup>& lookupBuf)
 	{
 		for (const EntityLookup& lookup : lookupBuf)
 		{
-			EntityReg& reg = entityRegistry[lookup.entityId];
-			reg.groupPos = lookup.groupPos;
+			// Entities removed (but not flushed yet) keep their proxies, their free entries are left untouched
+			EntityReg& reg = entityRegistry[entityIndex(lookup.entityId)];
+			if (reg.generation == entityGeneration(lookup.entityId))
+			{
+				reg.groupPos = lookup.groupPos;
+			}
 		}
 	}
 
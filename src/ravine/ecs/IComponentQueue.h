@@ -0,0 +1,29 @@
+#ifndef ICOMPONENTQUEUE_H
+#define ICOMPONENTQUEUE_H
+
+#include "Entity.hpp"
+
+namespace rv
+{
+	class IComponentQueue
+	{
+	  public:
+		IComponentQueue() = default;
+		virtual ~IComponentQueue() = default;
+		/**
+		 * @brief Inserts the queued components of the given entities on an archetype group (in the given order).
+		 *
+		 * @param archetype Archetype the components are inserted on.
+		 * @param entities Entities whose queued components are inserted.
+		 * @param count Amount of entities.
+		 */
+		virtual inline void insert(ArchetypeId archetype, const Entity* entities, int32_t count) = 0;
+		/**
+		 * @brief Assigns the queued components left (not inserted) to the entities that already have them.
+		 */
+		virtual inline void assign() = 0;
+		virtual inline void clear() = 0;
+	};
+} // namespace rv
+
+#endif
@@ -1,24 +1,81 @@
 #ifndef ICOMPONENTSTORAGE_HPP
 #define ICOMPONENTSTORAGE_HPP
 
-#include "ComponentsGroup.hpp"
+#include "Entity.hpp"
 #include <inttypes.h>
-#include <map>
 #include <vector>
 
 namespace rv
 {
-	using GroupIdList = std::map<GroupMask, std::vector<int32_t>*, GroupMaskCmp>;
-	using GroupIdPair = std::pair<GroupMask, std::vector<int32_t>*>;
+	/**
+	 * @brief Group positions to be removed, indexed by archetype id.
+	 */
+	using GroupIdList = std::vector<std::vector<int32_t>>;
 
 	class IComponentStorage
 	{
+	  protected:
+		/**
+		 * @brief Structural version, increased on every change of the groups layout
+		 * (insertions, removals, growth or new groups), so queries know when to be rebuilt.
+		 */
+		uint32_t version = 0;
+
 	  public:
 		IComponentStorage() = default;
 		virtual ~IComponentStorage() = default;
-		virtual inline void swapComponent(int32_t entityId, GroupMask oldTypeMask, GroupMask newTypeMask) = 0;
-		virtual inline void removeComponent(int32_t entityId, GroupMask typeMask) = 0;
-		virtual inline void removeComponents(GroupIdList groupIdList) = 0;
+		inline uint32_t getVersion() const { return version; }
+		virtual inline void swapComponent(int32_t entityId, ArchetypeId oldArchetype, ArchetypeId newArchetype) = 0;
+		/**
+		 * @brief Moves the components at the given group positions of an archetype group
+		 * to the end of another archetype group (in the same order).
+		 *
+		 * @param groupPos Sorted list (ascending) of group positions to be moved.
+		 * @param count Size of the given group positions list.
+		 * @param srcArchetype Archetype the components are moved from.
+		 * @param dstArchetype Archetype the components are moved to.
+		 */
+		virtual inline void moveComponents(const int32_t* groupPos, int32_t count, ArchetypeId srcArchetype,
+						   ArchetypeId dstArchetype) = 0;
+		virtual inline void removeComponent(int32_t entityId, ArchetypeId archetype) = 0;
+		/**
+		 * @brief Removes the components at the given group positions of a single archetype group.
+		 *
+		 * @param groupPos Sorted list (ascending) of group positions to be removed.
+		 * @param count Size of the given group positions list.
+		 * @param archetype Archetype the components are removed from.
+		 */
+		virtual inline void removeComponents(const int32_t* groupPos, int32_t count, ArchetypeId archetype) = 0;
+		virtual inline void removeComponents(const GroupIdList& groupIdList) = 0;
+		/**
+		 * @brief Reorders the groups layout so the groups with the most insertions/removals (churn) are placed
+		 * toward the end of the storage, where growing and shrinking rolls the fewest components.
+		 * Group positions are kept, only the groups memory is relocated.
+		 */
+		virtual inline void reorderGroups() = 0;
+		/**
+		 * @brief Unrolls every group (its tip is moved back to its base), so all storages of an archetype hold
+		 * its components on a single contiguous span. Group positions are kept.
+		 */
+		virtual inline void unrollGroups() = 0;
+		/**
+		 * @brief Incremental compaction step, groups are unrolled and the gaps between them are shrunk down to
+		 * the slack policy headroom, group by group (resuming where the last step stopped).
+		 *
+		 * @param budget Amount of bytes that may be moved, decreased by the bytes actually moved.
+		 * @return true If the compaction pass reached the last group, false if the budget ran out before.
+		 */
+		virtual inline bool compact(size_t& budget) = 0;
+		/**
+		 * @brief Packs the groups (as \see{compact}) and releases all the capacity after the last group
+		 * (decommitting its pages on paged storages).
+		 */
+		virtual inline void shrinkToFit() = 0;
+		/**
+		 * @brief Shrinks the storage if its size dropped below the shrink policy threshold. Removals don't
+		 * shrink the storage themselves, it is checked once per storage at the end of each flush.
+		 */
+		virtual inline void applyShrinkPolicy() = 0;
 	};
 } // namespace rv
 
@@ -0,0 +1,15 @@
+#ifndef IENTITYQUEUE_H
+#define IENTITYQUEUE_H
+
+namespace rv
+{
+	class IEntityQueue
+	{
+	  public:
+		IEntityQueue() = default;
+		virtual ~IEntityQueue() = default;
+		virtual inline void flush() = 0;
+	};
+} // namespace rv
+
+#endif
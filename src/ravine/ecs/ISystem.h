@@ -1,11 +1,36 @@
 #ifndef ISYSTEM_H
 #define ISYSTEM_H
 
+#include "ComponentType.h"
+
+#include <vector>
+
+namespace tf
+{
+	class Subflow;
+}
+
 class ISystem
 {
   public:
 	virtual ~ISystem() = default;
 	virtual void update(double deltaTime) = 0;
+
+	/**
+	 * @brief Update called from a scheduler task, parallel work can be spawned (and joined) on the subflow.
+	 *
+	 * @param deltaTime Timespan between last and current frame (in seconds).
+	 * @param subflow Subflow of the scheduler task running this system.
+	 */
+	virtual void update(double deltaTime, [[maybe_unused]] tf::Subflow& subflow) { update(deltaTime); }
+
+	/**
+	 * @brief Gets the component types read and written by the system update, used to schedule it.
+	 *
+	 * @param reads Component types only read by the system.
+	 * @param writes Component types written by the system.
+	 */
+	virtual void getAccess(std::vector<rv::ComponentTypeId>& reads, std::vector<rv::ComponentTypeId>& writes) const = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,142 @@
+#ifndef SYSTEMSMANAGER_HPP
+#define SYSTEMSMANAGER_HPP
+
+#include "ComponentType.h"
+#include "ISystem.h"
+
+#include <algorithm>
+#include <taskflow/taskflow.hpp>
+#include <vector>
+
+namespace rv
+{
+	/**
+	 * @brief Runs systems once per frame as a task graph, so systems with no conflicting component
+	 * accesses run concurrently. Two systems conflict when one writes a component type the other reads
+	 * or writes, conflicting systems run in their registration order.
+	 * Structural operations (entity creation/removal) must not happen while the systems are running,
+	 * they can be flushed after \see{update}.
+	 */
+	class SystemsManager
+	{
+		struct SystemEntry
+		{
+			ISystem* system;
+			/**
+			 * @brief Sorted component types only read by the system.
+			 */
+			std::vector<ComponentTypeId> reads;
+			/**
+			 * @brief Sorted component types written by the system.
+			 */
+			std::vector<ComponentTypeId> writes;
+		};
+
+		tf::Executor& executor;
+		tf::Taskflow taskflow;
+		std::vector<SystemEntry> systems;
+
+		/**
+		 * @brief Time step of the current frame (read by the system tasks).
+		 */
+		double frameDeltaTime = 0.0;
+
+		/**
+		 * @brief Either or not the task graph needs to be rebuilt (systems were added).
+		 */
+		bool isDirty = false;
+
+	  public:
+		inline explicit SystemsManager(tf::Executor& executor) : executor(executor) {}
+
+		/**
+		 * @brief Registers a system, it runs after every previously registered system it conflicts with.
+		 *
+		 * @param system System to be scheduled (must outlive the manager).
+		 */
+		inline void addSystem(ISystem* system);
+
+		/**
+		 * @brief Runs all registered systems (blocks until all of them are done).
+		 *
+		 * @param deltaTime Timespan between last and current frame (in seconds).
+		 */
+		inline void update(double deltaTime);
+
+	  private:
+		inline void buildGraph();
+
+		inline static bool conflicts(const SystemEntry& a, const SystemEntry& b);
+
+		inline static bool intersects(const std::vector<ComponentTypeId>& a, const std::vector<ComponentTypeId>& b);
+	};
+
+	inline void SystemsManager::addSystem(ISystem* system)
+	{
+		SystemEntry entry = {system, {}, {}};
+		system->getAccess(entry.reads, entry.writes);
+		std::sort(entry.reads.begin(), entry.reads.end());
+		std::sort(entry.writes.begin(), entry.writes.end());
+		systems.push_back(std::move(entry));
+		isDirty = true;
+	}
+
+	inline void SystemsManager::update(double deltaTime)
+	{
+		if (isDirty)
+		{
+			buildGraph();
+		}
+		frameDeltaTime = deltaTime;
+		executor.run(taskflow).wait();
+	}
+
+	inline void SystemsManager::buildGraph()
+	{
+		taskflow.clear();
+		std::vector<tf::Task> tasks;
+		tasks.reserve(systems.size());
+		for (size_t i = 0; i < systems.size(); i++)
+		{
+			ISystem* system = systems[i].system;
+			tasks.push_back(taskflow.emplace([this, system](tf::Subflow& subflow) {
+				system->update(frameDeltaTime, subflow);
+			}));
+
+			// Keep the registration order between conflicting systems
+			for (size_t j = 0; j < i; j++)
+			{
+				if (conflicts(systems[j], systems[i]))
+				{
+					tasks[j].precede(tasks[i]);
+				}
+			}
+		}
+		isDirty = false;
+	}
+
+	inline bool SystemsManager::conflicts(const SystemEntry& a, const SystemEntry& b)
+	{
+		return intersects(a.writes, b.writes) || intersects(a.writes, b.reads) || intersects(a.reads, b.writes);
+	}
+
+	inline bool SystemsManager::intersects(const std::vector<ComponentTypeId>& a,
+					       const std::vector<ComponentTypeId>& b)
+	{
+		// Both lists are sorted
+		std::vector<ComponentTypeId>::const_iterator itA = a.begin();
+		std::vector<ComponentTypeId>::const_iterator itB = b.begin();
+		while (itA != a.end() && itB != b.end())
+		{
+			if (*itA == *itB)
+			{
+				return true;
+			}
+			(*itA < *itB) ? itA++ : itB++;
+		}
+		return false;
+	}
+
+} // namespace rv
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef VIRTUALMEMORY_H
+#define VIRTUALMEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace rv
+{
+
+	/**
+	 * @brief Returns the size of a virtual memory page.
+	 *
+	 * @return size_t Page size (in bytes).
+	 */
+	inline size_t getPageSize()
+	{
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<size_t>(info.dwPageSize);
+#else
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+	/**
+	 * @brief Rounds the given size up to a multiple of the virtual memory page size.
+	 *
+	 * @param bytes Size to be rounded (in bytes).
+	 * @return size_t Page aligned size (in bytes).
+	 */
+	inline size_t alignToPage(const size_t bytes)
+	{
+		static const size_t pageSize = getPageSize();
+		return (bytes + pageSize - 1) / pageSize * pageSize;
+	}
+
+	/**
+	 * @brief Reserves a range of virtual address space, without backing it by physical memory.
+	 *
+	 * @param bytes Size of the range (in bytes, page aligned).
+	 * @return void* Start of the reserved range or nullptr in case of failure.
+	 */
+	inline void* reserveMemory(const size_t bytes)
+	{
+#if defined(_WIN32)
+		return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+		void* addr = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		return (addr == MAP_FAILED) ? nullptr : addr;
+#endif
+	}
+
+	/**
+	 * @brief Commits pages of a reserved range, so they can be read and written.
+	 *
+	 * @param addr Start of the pages to commit (page aligned).
+	 * @param bytes Size of the pages to commit (in bytes, page aligned).
+	 * @return bool Either or not the pages have been commited.
+	 */
+	inline bool commitMemory(void* addr, const size_t bytes)
+	{
+#if defined(_WIN32)
+		return VirtualAlloc(addr, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+		return mprotect(addr, bytes, PROT_READ | PROT_WRITE) == 0;
+#endif
+	}
+
+	/**
+	 * @brief Decommits pages of a reserved range, releasing their physical memory back to the OS.
+	 * The address range is kept reserved.
+	 *
+	 * @param addr Start of the pages to decommit (page aligned).
+	 * @param bytes Size of the pages to decommit (in bytes, page aligned).
+	 */
+	inline void decommitMemory(void* addr, const size_t bytes)
+	{
+#if defined(_WIN32)
+		VirtualFree(addr, bytes, MEM_DECOMMIT);
+#else
+		madvise(addr, bytes, MADV_DONTNEED);
+		mprotect(addr, bytes, PROT_NONE);
+#endif
+	}
+
+	/**
+	 * @brief Releases a whole reserved range (and all its commited pages).
+	 *
+	 * @param addr Start of the reserved range.
+	 * @param bytes Size of the reserved range (in bytes).
+	 */
+	inline void releaseMemory(void* addr, const size_t bytes)
+	{
+#if defined(_WIN32)
+		(void)bytes;
+		VirtualFree(addr, 0, MEM_RELEASE);
+#else
+		munmap(addr, bytes);
+#endif
+	}
+
+} // namespace rv
+
+#endif
@@ -10,7 +10,7 @@ using namespace rv;
 class BoundarySystem : public BaseSystem<Velocity, Position>
 {
   public:
-	void update(double deltaTime, int32_t size, Velocity* const vel, Position* const pos) final
+	void update(double, int32_t size, Velocity* const vel, Position* const pos) final
 	{
 		for (int32_t i = 0; i < size; i++)
 		{
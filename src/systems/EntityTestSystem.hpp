@@ -7,13 +7,13 @@
 
 using namespace rv;
 
-class EntityTestSystem : public BaseSystem<EntityProxy, Position>
+class EntityTestSystem : public BaseSystem<const EntityProxy, const Position>
 {
-	void update(double deltaTime, int32_t size, EntityProxy* const e, Position* const p) final
+	void update(double, int32_t size, const EntityProxy* const e, const Position* const p) final
 	{
 		for (int32_t i = 0; i < size; i++)
 		{
-			fprintf(stdout, "|Ent(%u)|Pos(%.3f,%.3f)", e[i].entityId, p[i].x, p[i].y);
+			fprintf(stdout, "|Ent(%llu)|Pos(%.3f,%.3f)", (unsigned long long)e[i].entityId, p[i].x, p[i].y);
 		}
 	}
 };
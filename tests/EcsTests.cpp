@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ravine/ecs.h"
+
+using namespace rv;
+
+/**
+ * @brief Component of a test, each test uses its own id (its request number) so it runs on empty storages.
+ */
+template <int32_t Id>
+struct TestComp
+{
+	int32_t value;
+};
+
+/**
+ * @brief Marker component, used to split the test components into several archetype groups.
+ */
+template <int32_t Id>
+struct Tag
+{
+	int32_t value;
+};
+
+/**
+ * @brief Test value kept on the heap, so the components holding it are not trivially relocatable.
+ */
+struct HeapValue
+{
+	std::string text;
+
+	HeapValue(const int32_t value = 0) : text("value " + std::to_string(value) + " is kept on the heap") {}
+
+	bool operator!=(const int32_t value) const { return text != HeapValue(value).text; }
+};
+
+template <>
+struct TestComp<5>
+{
+	HeapValue value;
+};
+
+template <>
+struct rv::UsePagedStorage<TestComp<4>> : std::true_type
+{
+};
+
+template <>
+struct rv::GroupAlignment<TestComp<6>> : std::integral_constant<size_t, 32>
+{
+};
+
+/**
+ * @brief Entities of a test, their test component holds their position on the entities list,
+ * so it can be checked after any storage operation. The entities left are removed once the test ends.
+ */
+template <int32_t Id>
+struct Fixture
+{
+	using Comp = TestComp<Id>;
+
+	ComponentStorage<Comp>* const storage = ComponentStorage<Comp>::getInstance();
+	std::vector<Entity> entities;
+
+	~Fixture()
+	{
+		for (Entity& entity : entities)
+		{
+			if (entity != InvalidEntity)
+			{
+				EntityRegistry::removeEntityImediatelly(entity);
+			}
+		}
+	}
+
+	template <class... TTags>
+	void create(const int32_t count)
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			const int32_t value = static_cast<int32_t>(entities.size());
+			entities.push_back(EntityRegistry::createEntity<Comp, TTags...>({value}, TTags{value}...));
+		}
+	}
+
+	template <class... TTags>
+	void createBatch(const int32_t count)
+	{
+		const int32_t first = static_cast<int32_t>(entities.size());
+		const EntityRange range = EntityRegistry::generateEntities<Comp, TTags...>(
+		    count, [first](const int32_t id, Comp& comp, TTags&... tags) {
+			    comp.value = first + id;
+			    ((tags.value = first + id), ...);
+		    });
+		entities.insert(entities.end(), range.entities, range.entities + range.count);
+	}
+
+	template <class... TTags>
+	void createDeferred(const int32_t count)
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			const int32_t value = static_cast<int32_t>(entities.size());
+			entities.push_back(EntityRegistry::createEntityDeferred<Comp, TTags...>({value}, TTags{value}...));
+		}
+	}
+
+	void remove(const int32_t first, const int32_t count)
+	{
+		for (int32_t i = first; i < first + count; i++)
+		{
+			EntityRegistry::removeEntityImediatelly(entities[i]);
+		}
+	}
+
+	/**
+	 * @brief Either or not every entity left still has its own test component.
+	 */
+	bool intact() const
+	{
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			if (entities[i] == InvalidEntity)
+			{
+				continue;
+			}
+			const Comp* comp = EntityRegistry::getComponent<const Comp>(entities[i]);
+			if (comp == nullptr || comp->value != static_cast<int32_t>(i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Either or not every group of the test component storage starts at its tip.
+	 */
+	bool unrolled() const
+	{
+		for (const ComponentsGroup<Comp>* group : storage->groups)
+		{
+			if (group->tipOffset != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * @brief System counting the entities (and chunks) it processes, entities whose (optional) components
+ * are all present are counted as complete.
+ */
+template <class... TComps>
+class CountSystem : public BaseSystem<TComps...>
+{
+  public:
+	std::atomic<int32_t> entities = 0;
+	std::atomic<int32_t> complete = 0;
+	std::atomic<int32_t> chunks = 0;
+
+	/**
+	 * @brief Runs a serial update, returning the amount of entities processed by it.
+	 */
+	int32_t run()
+	{
+		const int32_t processed = entities;
+		static_cast<ISystem&>(*this).update(0.0);
+		return entities - processed;
+	}
+
+	void update(double, int32_t size, QueriedComponent<TComps>* const... comps) final
+	{
+		entities += size;
+		complete += ((comps != nullptr) && ...) ? size : 0;
+		chunks++;
+	}
+};
+
+/**
+ * @brief System running a callback on every chunk it processes.
+ */
+template <class... TComps>
+class CallbackSystem : public BaseSystem<TComps...>
+{
+	std::function<void(int32_t, QueriedComponent<TComps>*...)> callback;
+
+  public:
+	explicit CallbackSystem(std::function<void(int32_t, QueriedComponent<TComps>*...)> callback)
+	    : callback(std::move(callback))
+	{
+	}
+
+	void update(double, int32_t size, QueriedComponent<TComps>* const... comps) final { callback(size, comps...); }
+};
+
+bool deferredCreationTest()
+{
+	// Entities removed or changed before their deferred creation is flushed
+	Fixture<2> fixture;
+	fixture.createDeferred(4);
+	const Entity removed = fixture.entities[0];
+	EntityRegistry::removeEntity(fixture.entities[0]);
+	EntityRegistry::removeEntityImediatelly(fixture.entities[1]);
+	EntityRegistry::addComponent<Tag<2>>(fixture.entities[2]);
+
+	// The freed registry entries are recycled before the flush
+	fixture.create(1);
+	EntityRegistry::flushEntityOperations();
+
+	return !EntityRegistry::isAlive(removed) && fixture.storage->getSize() == 3 && fixture.intact() &&
+	       EntityRegistry::getComponent<const Tag<2>>(fixture.entities[2]) != nullptr;
+}
+
+bool batchCreationTest()
+{
+	// Batches are stored in place, whether generated or copied from a single value
+	Fixture<1> fixture;
+	fixture.createBatch<Tag<1>>(64);
+	const EntityRange range = EntityRegistry::createEntities<Tag<1>>(32, Tag<1>{-1});
+	std::vector<Entity> copies(range.entities, range.entities + range.count);
+	bool copied = copies.size() == 32;
+	for (Entity& copy : copies)
+	{
+		const Tag<1>* tag = EntityRegistry::getComponent<const Tag<1>>(copy);
+		copied &= tag != nullptr && tag->value == -1;
+		EntityRegistry::removeEntityImediatelly(copy);
+	}
+
+	// Empty (or negative) batches create nothing
+	const bool rejected = EntityRegistry::createEntities<Tag<1>>(-1, Tag<1>{-1}).count == 0 &&
+			      EntityRegistry::createEntities<Tag<1>>(0).count == 0;
+	return fixture.storage->getSize() == 64 && fixture.intact() && copied && rejected &&
+	       ComponentStorage<Tag<1>>::getInstance()->getSize() == 64;
+}
+
+bool slackPolicyTest()
+{
+	// Insertions fill the group slack, so the next group is not rolled
+	Fixture<3> fixture;
+	EntityRegistry::setSlackPolicy<TestComp<3>>({8, 0.0f});
+	fixture.create(4);
+	fixture.create<Tag<3>>(4);
+	const int32_t nextBase = fixture.storage->groups[1]->baseOffset;
+	fixture.create(4);
+	return fixture.storage->groups[1]->baseOffset == nextBase && fixture.unrolled() && fixture.intact();
+}
+
+bool pagedStorageTest()
+{
+	// Paged storages grow by committing pages, so their data is never moved
+	Fixture<4> fixture;
+	const TestComp<4>* data = fixture.storage->data;
+	fixture.create(20000);
+	return fixture.storage->data == data && fixture.storage->getCapacity() >= 20000 && fixture.intact();
+}
+
+bool relocationTest()
+{
+	// Non-trivial components survive growth, rolls and removals
+	Fixture<5> fixture;
+	fixture.create(64);
+	fixture.create<Tag<5>>(64);
+	fixture.create(64);
+	fixture.remove(10, 20);
+	fixture.remove(70, 20);
+	return fixture.storage->getSize() == 152 && fixture.intact();
+}
+
+bool alignmentTest()
+{
+	// The data block is cache line aligned and every group starts on the group alignment
+	Fixture<6> fixture;
+	fixture.create(3);
+	fixture.create<Tag<6>>(3);
+	fixture.create<Tag<6>, Tag<106>>(3);
+	fixture.create(5);
+	bool aligned = reinterpret_cast<uintptr_t>(fixture.storage->data) % 64 == 0;
+	for (ComponentsGroup<TestComp<6>>* group : fixture.storage->groups)
+	{
+		aligned &= reinterpret_cast<uintptr_t>(group->dataPos()) % 32 == 0;
+	}
+	return aligned && fixture.intact();
+}
+
+template <int32_t Id, int32_t... Tags>
+void createTagged(Fixture<Id>& fixture, const int32_t count, std::integer_sequence<int32_t, Tags...>)
+{
+	(fixture.template create<Tag<Id * 100 + Tags>>(count), ...);
+}
+
+bool querySpillTest()
+{
+	// Queries matching more groups than the inline buffer holds spill to the heap (and are rebuilt when more
+	// groups are added)
+	Fixture<8> fixture;
+	createTagged(fixture, 2, std::make_integer_sequence<int32_t, 12>());
+	CountSystem<const TestComp<8>> system;
+	const int32_t spilled = system.run();
+	createTagged(fixture, 1, std::make_integer_sequence<int32_t, 16>());
+	return spilled == 24 && system.run() == 40 && fixture.intact();
+}
+
+bool parallelGrainTest()
+{
+	// Groups are split into work items of the grain size (small groups coalesced), each entity processed once
+	Fixture<11> fixture;
+	fixture.create(10);
+	fixture.create<Tag<11>>(25);
+	tf::Executor executor(4);
+	CountSystem<const TestComp<11>> system;
+	system.setParallel(&executor, 8);
+	return system.run() == 35 && system.chunks >= 5;
+}
+
+bool schedulingTest()
+{
+	// Systems reading the same components run concurrently, after the system writing them
+	Fixture<12> fixture;
+	fixture.create(16);
+	CallbackSystem<TestComp<12>> writer([](const int32_t size, TestComp<12>* comps) {
+		for (int32_t i = 0; i < size; i++)
+		{
+			comps[i].value += size;
+		}
+	});
+	std::atomic<int32_t> written = 0;
+	std::atomic<int32_t> arrived = 0;
+	std::atomic<int32_t> met = 0;
+	const auto read = [&](const int32_t size, const TestComp<12>* comps) {
+		written += (comps[0].value == size && comps[size - 1].value == 2 * size - 1) ? 1 : 0;
+		// Each reader waits (up to a deadline) for the other one to arrive
+		arrived++;
+		const std::chrono::steady_clock::time_point deadline =
+		    std::chrono::steady_clock::now() + std::chrono::seconds(2);
+		while (arrived < 2 && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+		met += (arrived == 2) ? 1 : 0;
+	};
+	CallbackSystem<const TestComp<12>> firstReader(read);
+	CallbackSystem<const TestComp<12>> secondReader(read);
+
+	tf::Executor executor(4);
+	SystemsManager manager(executor);
+	manager.addSystem(&writer);
+	manager.addSystem(&firstReader);
+	manager.addSystem(&secondReader);
+	manager.update(0.0);
+	return written == 2 && met == 2;
+}
+
+bool changedOnlyTest()
+{
+	// Change filtered systems skip the groups left unwritten since their last update
+	Fixture<14> fixture;
+	fixture.create(8);
+	fixture.create<Tag<14>>(8);
+	CountSystem<const TestComp<14>> system;
+	system.setChangedOnly(true);
+	const int32_t first = system.run();
+	const int32_t idle = system.run();
+	EntityRegistry::getComponent<TestComp<14>>(fixture.entities[0]);
+	return first == 16 && idle == 0 && system.run() == 8 && system.run() == 0;
+}
+
+/**
+ * @brief Counts the entities with the test component, the tagged ones being optional and the excluded ones skipped.
+ */
+class FilterSystem : public CountSystem<const TestComp<15>, Optional<const Tag<15>>>
+{
+  public:
+	FilterSystem() { without<const Tag<115>>(); }
+};
+
+bool queryFiltersTest()
+{
+	// Optional types don't restrict the matched archetypes, excluded types do
+	Fixture<15> fixture;
+	fixture.create(2);
+	fixture.create<Tag<15>>(3);
+	fixture.create<Tag<115>>(4);
+	FilterSystem system;
+	return system.run() == 5 && system.complete == 3;
+}
+
+bool componentMigrationTest()
+{
+	// Entities migrating between archetypes keep their handles and the values of the components they keep
+	Fixture<16> fixture;
+	fixture.create<Tag<16>>(8);
+	for (int32_t i = 0; i < 4; i++)
+	{
+		EntityRegistry::removeComponent<Tag<16>>(fixture.entities[i]);
+	}
+	EntityRegistry::addComponent<Tag<116>>(fixture.entities[6], {6});
+	EntityRegistry::flushEntityOperations();
+
+	bool migrated = ComponentStorage<Tag<16>>::getInstance()->getSize() == 4;
+	for (int32_t i = 0; i < 8; i++)
+	{
+		const Tag<16>* tag = EntityRegistry::getComponent<const Tag<16>>(fixture.entities[i]);
+		migrated &= (i < 4) ? tag == nullptr : tag != nullptr && tag->value == i;
+	}
+	const Tag<116>* added = EntityRegistry::getComponent<const Tag<116>>(fixture.entities[6]);
+	return migrated && added != nullptr && added->value == 6 && fixture.intact();
+}
+
+bool slotReuseTest()
+{
+	// Freed slots are recycled most recent first, the handles of their removed entities are rejected
+	EntityRegistry::setSlotReuse(SlotReuse::Lifo);
+	Fixture<19> fixture;
+	fixture.create(4);
+	const Entity first = fixture.entities[1];
+	const Entity second = fixture.entities[2];
+	fixture.remove(1, 2);
+	fixture.create(2);
+	EntityRegistry::setSlotReuse(SlotReuse::Fifo);
+
+	Entity stale = first;
+	EntityRegistry::removeEntityImediatelly(stale);
+	const bool rejected = !EntityRegistry::isAlive(first) && !EntityRegistry::isAlive(second) &&
+			      EntityRegistry::getComponent<const TestComp<19>>(first) == nullptr;
+	return entityIndex(fixture.entities[4]) == entityIndex(second) &&
+	       entityIndex(fixture.entities[5]) == entityIndex(first) && rejected && fixture.intact();
+}
+
+bool batchRecyclingTest()
+{
+	// Batches recycle the slots freed by previous batches, so the registry does not keep growing
+	EntityRegistry::setSlotReuse(SlotReuse::Lifo);
+	Fixture<119> fixture;
+	std::vector<uint32_t> slots;
+	bool recycled = true;
+	for (int32_t cycle = 0; cycle < 8; cycle++)
+	{
+		fixture.createBatch(256);
+		std::vector<uint32_t> cycleSlots;
+		for (const Entity entity : fixture.entities)
+		{
+			cycleSlots.push_back(entityIndex(entity));
+		}
+		std::sort(cycleSlots.begin(), cycleSlots.end());
+		recycled &= cycle == 0 || cycleSlots == slots;
+		slots = cycleSlots;
+		fixture.remove(0, 256);
+		fixture.entities.clear();
+	}
+	EntityRegistry::setSlotReuse(SlotReuse::Fifo);
+	return recycled;
+}
+
+bool untrackedEntitiesTest()
+{
+	// Untracked entities are only reached by systems, and removed in bulk without touching the tracked ones
+	Fixture<20> fixture;
+	fixture.create(4);
+	const std::vector<TestComp<20>> comps(16, TestComp<20>{-1});
+	EntityRegistry::createUntrackedEntities<TestComp<20>>(16, comps.data());
+	fixture.create(4);
+	CountSystem<const TestComp<20>> system;
+	const int32_t created = system.run();
+	EntityRegistry::removeUntrackedEntities<TestComp<20>>();
+	EntityRegistry::flushEntityOperations();
+	return created == 24 && system.run() == 8 && fixture.storage->getSize() == 8 && fixture.intact();
+}
+
+bool reorderTest()
+{
+	// The group with the most insertions and removals is moved to the end of the storage
+	Fixture<21> fixture;
+	fixture.create(4);
+	fixture.create<Tag<21>>(4);
+	const ComponentsGroup<TestComp<21>>* hotGroup = fixture.storage->groups.front();
+	for (int32_t cycle = 0; cycle < 32; cycle++)
+	{
+		fixture.create(16);
+		fixture.remove(8, 16);
+		fixture.entities.resize(8);
+	}
+	EntityRegistry::setReorderPeriod(1);
+	EntityRegistry::flushEntityOperations();
+	EntityRegistry::setReorderPeriod(0);
+	return fixture.storage->groups.back() == hotGroup && fixture.intact();
+}
+
+bool lockstepTipsTest()
+{
+	// Flushes unroll the groups rolled by immediate insertions, so each group is then updated as a single chunk
+	Fixture<22> fixture;
+	fixture.create(4);
+	fixture.create<Tag<22>>(4);
+	fixture.create(2);
+	const bool rolled = !fixture.unrolled();
+	CountSystem<const TestComp<22>, const Tag<22>> system;
+	system.run();
+	const int32_t rolledChunks = system.chunks;
+
+	EntityRegistry::setLockstepTips(true);
+	EntityRegistry::flushEntityOperations();
+	EntityRegistry::setLockstepTips(false);
+	system.chunks = 0;
+	return rolled && rolledChunks == 2 && system.run() == 4 && system.chunks == 1 && fixture.unrolled() &&
+	       fixture.intact();
+}
+
+bool compactTest()
+{
+	// Compaction unrolls the rolled groups within the given budget, resuming where it stopped
+	Fixture<23> fixture;
+	fixture.create(4);
+	fixture.create<Tag<23>>(4);
+	fixture.create<Tag<123>>(4);
+	fixture.create<Tag<223>>(4);
+	fixture.create(2);
+	const bool rolled = !fixture.unrolled();
+
+	// A group is never split, so a single byte only pays for the first moved group
+	size_t budget = 1;
+	const bool exhausted = !fixture.storage->compact(budget);
+	int32_t calls = 1;
+	for (budget = 1; !fixture.storage->compact(budget); budget = 1)
+	{
+		calls++;
+	}
+	return rolled && exhausted && calls > 1 && fixture.unrolled() && fixture.intact();
+}
+
+bool shrinkPolicyTest()
+{
+	// The capacity follows the population down once the removals are flushed, keeping the policy headroom
+	Fixture<24> fixture;
+	EntityRegistry::setShrinkPolicy<TestComp<24>>({0.25f, 0.5f});
+	fixture.create(1000);
+	const int32_t grownCapacity = fixture.storage->getCapacity();
+	fixture.remove(10, 500);
+	for (int32_t i = 510; i < 1000; i++)
+	{
+		EntityRegistry::removeEntity(fixture.entities[i]);
+	}
+	const bool deferred = fixture.storage->getCapacity() == grownCapacity;
+	EntityRegistry::flushEntityOperations();
+	return grownCapacity >= 1000 && deferred && fixture.storage->getCapacity() < grownCapacity / 10 &&
+	       fixture.storage->getCapacity() >= fixture.storage->getSize() && fixture.intact();
+}
+
+bool shrinkToFitTest()
+{
+	// Every unused slot is released, the kept components are packed
+	Fixture<124> fixture;
+	fixture.create(1000);
+	fixture.remove(100, 900);
+	EntityRegistry::shrinkToFit();
+	return fixture.storage->getCapacity() == 100 && fixture.storage->getSize() == 100 && fixture.intact();
+}
+
+bool reserveTest()
+{
+	// Creating the reserved entities doesn't reallocate the storage
+	Fixture<25> fixture;
+	EntityRegistry::reserve<TestComp<25>>(500);
+	const TestComp<25>* data = fixture.storage->data;
+	const int32_t capacity = fixture.storage->getCapacity();
+	fixture.create(500);
+	return capacity >= 500 && fixture.storage->data == data && fixture.storage->getCapacity() == capacity &&
+	       fixture.intact();
+}
+
+bool growthPolicyTest()
+{
+	// A batch that doesn't fit grows the storage by the policy factor over its requirement
+	Fixture<125> fixture;
+	EntityRegistry::setGrowthPolicy<TestComp<125>>({2.0f});
+	fixture.createBatch(100);
+	return fixture.storage->getCapacity() == 200 && fixture.intact();
+}
+
+int main()
+{
+	struct Test
+	{
+		const char* name;
+		bool (*run)();
+	};
+	const Test tests[] = {
+	    {"Batch creation", batchCreationTest},
+	    {"Deferred creation", deferredCreationTest},
+	    {"Slack policy", slackPolicyTest},
+	    {"Paged storage", pagedStorageTest},
+	    {"Non-trivial relocation", relocationTest},
+	    {"Alignment", alignmentTest},
+	    {"Query spill", querySpillTest},
+	    {"Parallel grain", parallelGrainTest},
+	    {"Systems scheduling", schedulingTest},
+	    {"Changed only", changedOnlyTest},
+	    {"Query filters", queryFiltersTest},
+	    {"Component migration", componentMigrationTest},
+	    {"Slot reuse", slotReuseTest},
+	    {"Batch recycling", batchRecyclingTest},
+	    {"Untracked entities", untrackedEntitiesTest},
+	    {"Group reorder", reorderTest},
+	    {"Lockstep tips", lockstepTipsTest},
+	    {"Incremental compaction", compactTest},
+	    {"Shrink policy", shrinkPolicyTest},
+	    {"Shrink to fit", shrinkToFitTest},
+	    {"Reserve", reserveTest},
+	    {"Growth policy", growthPolicyTest},
+	};
+
+	int32_t failed = 0;
+	for (const Test& test : tests)
+	{
+		const bool passed = test.run();
+		fprintf(stdout, "%s test %s\n", test.name, passed ? "passed" : "FAILED");
+		failed += passed ? 0 : 1;
+	}
+	return failed == 0 ? 0 : 1;
+}